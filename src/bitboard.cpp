@@ -3,17 +3,21 @@
 
 #include "bitboard.h"
 
-U64 BitBoard::set_mask[64] = {0};
-U64 BitBoard::clear_mask[64] = {0};
-U64 BitBoard::ray_attacks[64][8] = {0};
-U64 BitBoard::knight_moves[64] = {0};
-U64 BitBoard::king_moves[64] = {0};
-U64 BitBoard::rank[8] = {0};
-U64 BitBoard::file[8] = {0};
-U64 BitBoard::rank_sq[64] = {0};
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+Magic BitBoard::bishop_magics[64];
+Magic BitBoard::rook_magics[64];
+U64 BitBoard::bishop_table[0x1480];
+U64 BitBoard::rook_table[0x19000];
+SliderBackend BitBoard::slider_backend = Magics;
+bool BitBoard::fill_avx2 = false;
+bool BitBoard::popcnt_hw = false;
+const char *BitBoard::slider_backend_names[2] = { "magics", "pext" };
 
 // Table used for bit_scan
-static const int index64[64] = {
+const int BitBoard::index64[64] = {
    0, 47,  1, 56, 48, 27,  2, 60,
   57, 49, 41, 37, 28, 16,  3, 61,
   54, 58, 35, 52, 50, 42, 21, 44,
@@ -24,134 +28,292 @@ static const int index64[64] = {
   13, 18,  8, 12,  7,  6,  5, 63
 };
 
-static U64 not_file_a, not_file_ab, not_file_h, not_file_gh, not_rank_1, not_rank_8;
-
-static U64 noNoEa(const U64 &bb) {return (bb & not_file_h) << 17;}
-static U64 noEaEa(const U64 &bb) {return (bb & not_file_gh) << 10;}
-static U64 soEaEa(const U64 &bb) {return (bb & not_file_gh) >>  6;}
-static U64 soSoEa(const U64 &bb) {return (bb & not_file_h) >> 15;}
-static U64 noNoWe(const U64 &bb) {return (bb & not_file_a) << 15;}
-static U64 noWeWe(const U64 &bb) {return (bb & not_file_ab) <<  6;}
-static U64 soWeWe(const U64 &bb) {return (bb & not_file_ab) >> 10;}
-static U64 soSoWe(const U64 &bb) {return (bb & not_file_a) >> 17;}
-static U64 nortOne(const U64 &bb) {return (bb & not_rank_8) << 8;}
-static U64 soutOne(const U64 &bb) {return (bb & not_rank_1) >> 8;}
-static U64 eastOne(const U64 &bb) {return (bb & not_file_h) << 1;}
-static U64 westOne(const U64 &bb) {return (bb & not_file_a) >> 1;}
-U64 BitBoard::noEaOne(const U64 &bb) {return (bb & not_file_h) << 9;}
-U64 BitBoard::soEaOne(const U64 &bb) {return (bb & not_file_h) >> 7;}
-U64 BitBoard::soWeOne(const U64 &bb) {return (bb & not_file_a) >> 9;}
-U64 BitBoard::noWeOne(const U64 &bb) {return (bb & not_file_a) << 7;}
+static const U64 bishop_magic_numbers[64] = {
+  0x10102002004A1420ULL, 0x8020040400584008ULL, 0x10510800811201C8ULL, 0x5204042080000088ULL,
+  0x2204106880000002ULL, 0x1401042004000000ULL, 0x0400880410042004ULL, 0x0028208200A02020ULL,
+  0x1500241990010E00ULL, 0x8001200182020A40ULL, 0x40004101030B0000ULL, 0x8002041042000100ULL,
+  0x4010011041020038ULL, 0x0000010421044000ULL, 0x1500210808020A00ULL, 0x8000088400880520ULL,
+  0x0405004010040100ULL, 0x1005823210040108ULL, 0x2708008102040011ULL, 0x4048200404009100ULL,
+  0x0018104101400024ULL, 0x0003000601190101ULL, 0x8004803108491000ULL, 0x8014241200820800ULL,
+  0x0006E080100C3040ULL, 0x0501044A11041800ULL, 0x9020300008004045ULL, 0x0894080000220040ULL,
+  0x1001010083104000ULL, 0x5004030040900080ULL, 0x000400422C012400ULL, 0x0002128698404812ULL,
+  0x1010108404900440ULL, 0x0928021182084100ULL, 0x2006080409020024ULL, 0x1010202020180080ULL,
+  0xA010008200202200ULL, 0x2098015100019004ULL, 0x0002041440810811ULL, 0x802A02020000B098ULL,
+  0x0009015090004060ULL, 0x4000821082081001ULL, 0x0100210040420800ULL, 0x0800004010488A00ULL,
+  0x2000081104004040ULL, 0x4C8E029015000082ULL, 0x0420340322224842ULL, 0x1298260043400210ULL,
+  0x0000822802400008ULL, 0x00008A0101600000ULL, 0x3040003412080021ULL, 0x3040290220884800ULL,
+  0x4A1500401041004AULL, 0x8010200282020781ULL, 0x0020203142209091ULL, 0x0070300600902110ULL,
+  0x0040808800B62048ULL, 0x0000810400C44420ULL, 0x00080400440C0441ULL, 0x8340080020840411ULL,
+  0x0000000104208200ULL, 0x0000800810D00080ULL, 0x0400530411080200ULL, 0x4040702400932244ULL
+};
 
-void BitBoard::init() {
-  U64 rank_1 = 0xFFULL;
-  U64 file_a = 0x0101010101010101;
+static const U64 rook_magic_numbers[64] = {
+  0x1080004008801020ULL, 0x0840092002C03000ULL, 0x1900200010400900ULL, 0x0880100008000480ULL,
+  0x4200100420080200ULL, 0x8100020100080400ULL, 0x0200040110886200ULL, 0x0200008040220411ULL,
+  0x0404800084400220ULL, 0x0000401000402000ULL, 0x0086001081220440ULL, 0x0408800800100280ULL,
+  0x000A001201040820ULL, 0x8848800200840080ULL, 0x4001000100040200ULL, 0x0442000102105084ULL,
+  0x9080010020804100ULL, 0x0040404000201009ULL, 0x0000808010002009ULL, 0x2200090021D00100ULL,
+  0x0008008008040080ULL, 0x0004004002010040ULL, 0x0011040008015042ULL, 0x00000A0001768104ULL,
+  0x0000800080204009ULL, 0x2010004140002001ULL, 0x9800200280100080ULL, 0x1000100080080080ULL,
+  0x0442000A00049020ULL, 0x2100040080020080ULL, 0x0800120400900148ULL, 0x0010040A00128541ULL,
+  0x2800804000800030ULL, 0x1010002000400041ULL, 0x4000200011004100ULL, 0x0610008410800800ULL,
+  0x0400802402800800ULL, 0xC100020080800400ULL, 0x0002000802000401ULL, 0x0182085882000401ULL,
+  0x0220204000808000ULL, 0x2860100040024022ULL, 0x0001002004110040ULL, 0x99101042000A0020ULL,
+  0x0004080004008080ULL, 0x0010040002008080ULL, 0x2012004881020004ULL, 0x8300842444820011ULL,
+  0x0088403882010200ULL, 0x0820400080210100ULL, 0x0110910040A00300ULL, 0x0801100280080480ULL,
+  0x0242009008200600ULL, 0x1002000489500200ULL, 0x0040800200010080ULL, 0x0091800041000080ULL,
+  0x0000209300488001ULL, 0x04C1002414824001ULL, 0x020020000B001041ULL, 0x7000100004200901ULL,
+  0x8002002004100802ULL, 0x30010002084C0007ULL, 0x0888221800813004ULL, 0x4000002840840112ULL
+};
 
-  for (int i = 0; i < 8; i++) {
-    rank[i] = rank_1 << (8 * i);
-    file[i] = file_a << i;
-  }
+static const Direction bishop_dirs[4] = {NorthWest, NorthEast, SouthWest, SouthEast};
+static const Direction rook_dirs[4] = {North, East, South, West};
 
-  not_file_a = ~file[File_A];
-  not_file_ab = not_file_a & ~file[File_B];
-  not_file_h = ~file[File_H];
-  not_file_gh = ~file[File_G] & not_file_h;
-  not_rank_1 = ~rank[Rank_1];
-  not_rank_8 = ~rank[Rank_8];
+static constexpr U64 not_file_a = NOT_FILE_A;
+static constexpr U64 not_file_ab = NOT_FILE_A & ~0x0202020202020202ULL;
+static constexpr U64 not_file_h = NOT_FILE_H;
+static constexpr U64 not_file_gh = NOT_FILE_H & ~0x4040404040404040ULL;
+static constexpr U64 not_rank_1 = ~0xFFULL;
+static constexpr U64 not_rank_8 = ~0xFF00000000000000ULL;
 
-  U64 king_sq, knight_sq, attacks;
-  for (int sq = 0; sq < 64; sq++) {
-    king_sq = 1ULL << sq;
-    attacks = eastOne(king_sq) | westOne(king_sq);
-    king_sq |= attacks;
-    attacks |= nortOne(king_sq) | soutOne(king_sq);
-    king_moves[sq] = attacks;
+static constexpr U64 noNoEa(const U64 bb) {return (bb & not_file_h) << 17;}
+static constexpr U64 noEaEa(const U64 bb) {return (bb & not_file_gh) << 10;}
+static constexpr U64 soEaEa(const U64 bb) {return (bb & not_file_gh) >>  6;}
+static constexpr U64 soSoEa(const U64 bb) {return (bb & not_file_h) >> 15;}
+static constexpr U64 noNoWe(const U64 bb) {return (bb & not_file_a) << 15;}
+static constexpr U64 noWeWe(const U64 bb) {return (bb & not_file_ab) <<  6;}
+static constexpr U64 soWeWe(const U64 bb) {return (bb & not_file_ab) >> 10;}
+static constexpr U64 soSoWe(const U64 bb) {return (bb & not_file_a) >> 17;}
+static constexpr U64 nortOne(const U64 bb) {return (bb & not_rank_8) << 8;}
+static constexpr U64 soutOne(const U64 bb) {return (bb & not_rank_1) >> 8;}
+static constexpr U64 eastOne(const U64 bb) {return (bb & not_file_h) << 1;}
+static constexpr U64 westOne(const U64 bb) {return (bb & not_file_a) >> 1;}
 
-    knight_sq = 1ULL << sq;
-    knight_moves[sq] = noNoEa(knight_sq) | noEaEa(knight_sq) | soEaEa(knight_sq) | 
-                       soSoEa(knight_sq) | noNoWe(knight_sq) | noWeWe(knight_sq) | 
-                       soWeWe(knight_sq) | soSoWe(knight_sq);
+/*
+ * The fixed tables below are built by constexpr functions, so they are
+ * computed by the compiler and end up in read-only data with nothing left to
+ * do at startup. Only the magic attack tables are filled in init, their layout
+ * depends on the backend the cpu supports.
+ */
+static constexpr SquareTable make_set_mask() {
+  SquareTable table{};
+  for (int sq = 0; sq < 64; sq++) {
+    table[sq] = 1ULL << sq;
+  }
+  return table;
+}
 
-    set_mask[sq] = 1ULL << sq;
-    clear_mask[sq] = ~set_mask[sq];
-    rank_sq[sq] = sq / 8;
+static constexpr SquareTable make_clear_mask() {
+  SquareTable table{};
+  for (int sq = 0; sq < 64; sq++) {
+    table[sq] = ~(1ULL << sq);
   }
+  return table;
+}
 
-  // ray_attacks
-  U64 nort = 0x0101010101010100ULL;
-  for (int sq = 0; sq < 64; sq++, nort <<= 1) {
-    ray_attacks[sq][North] = nort;
+static constexpr SquareTable make_rank_sq() {
+  SquareTable table{};
+  for (int sq = 0; sq < 64; sq++) {
+    table[sq] = sq / 8;
   }
-  U64 sout = 0x0080808080808080ULL;
-  for (int sq = 63; sq >= 0; sq--, sout >>= 1) {
-    ray_attacks[sq][South] = sout;
+  return table;
+}
+
+static constexpr std::array<U64, 8> make_rank() {
+  std::array<U64, 8> table{};
+  for (int i = 0; i < 8; i++) {
+    table[i] = 0xFFULL << (8 * i);
   }
-  U64 east = 0xFEULL;
-  for (int f = 0; f < 8; f++, east = eastOne(east)) {
-    U64 ea = east;
-    for (int r8 = 0; r8 < 8*8; r8 += 8, ea <<= 8) {
-      ray_attacks[r8 + f][East] = ea;
-    }
+  return table;
+}
+
+static constexpr std::array<U64, 8> make_file() {
+  std::array<U64, 8> table{};
+  for (int i = 0; i < 8; i++) {
+    table[i] = 0x0101010101010101ULL << i;
   }
-  U64 west = 0x7F;
-  for (int f = 7; f >= 0; f--, west = westOne(west)) {
-    U64 we = west;
-    for (int r8 = 0; r8 < 8*8; r8 += 8, we <<= 8) {
-      ray_attacks[r8 + f][West] = we;
-    }
+  return table;
+}
+
+static constexpr SquareTable make_king_moves() {
+  SquareTable table{};
+  for (int sq = 0; sq < 64; sq++) {
+    U64 king_sq = 1ULL << sq;
+    U64 attacks = eastOne(king_sq) | westOne(king_sq);
+    king_sq |= attacks;
+    attacks |= nortOne(king_sq) | soutOne(king_sq);
+    table[sq] = attacks;
   }
-  U64 noea = 0x8040201008040200ULL;
-  for (int f = 0; f < 8; f++, noea = eastOne(noea)) {
-    U64 ne = noea;
-    for (int r8 = 0; r8 < 8*8; r8 += 8, ne <<= 8) {
-      ray_attacks[r8 + f][NorthEast] = ne;
-    }
+  return table;
+}
+
+static constexpr SquareTable make_knight_moves() {
+  SquareTable table{};
+  for (int sq = 0; sq < 64; sq++) {
+    U64 knight_sq = 1ULL << sq;
+    table[sq] = noNoEa(knight_sq) | noEaEa(knight_sq) | soEaEa(knight_sq) |
+                soSoEa(knight_sq) | noNoWe(knight_sq) | noWeWe(knight_sq) |
+                soWeWe(knight_sq) | soSoWe(knight_sq);
   }
-  U64 nowe = 0x0102040810204000ULL;
-  for (int f = 7; f >= 0; f--, nowe = westOne(nowe)) {
-    U64 nw = nowe;
-    for (int r8 = 0; r8 < 8*8; r8 += 8, nw <<= 8) {
-      ray_attacks[r8 + f][NorthWest] = nw;
+  return table;
+}
+
+// File and rank steps in Direction order, North first and then clockwise
+static constexpr int dir_file[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+static constexpr int dir_rank[8] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+
+// Every square from sq to the edge of the board, sq itself excluded
+static constexpr std::array<std::array<U64, 8>, 64> make_ray_attacks() {
+  std::array<std::array<U64, 8>, 64> table{};
+  for (int sq = 0; sq < 64; sq++) {
+    for (int dir = North; dir <= NorthWest; dir++) {
+      int f = sq % 8 + dir_file[dir];
+      int r = sq / 8 + dir_rank[dir];
+      for (; f >= 0 && f < 8 && r >= 0 && r < 8; f += dir_file[dir], r += dir_rank[dir]) {
+        table[sq][dir] |= 1ULL << (8 * r + f);
+      }
     }
   }
-  U64 soea = 0x0002040810204080ULL;
-  for (int f = 0; f < 8; f++, soea = eastOne(soea)) {
-    U64 se = soea;
-    for (int r8 = 56; r8 >= 0; r8 -= 8, se >>= 8) {
-      ray_attacks[r8 + f][SouthEast] = se;
+  return table;
+}
+
+// between holds the squares strictly between two aligned squares, line the
+// whole rank, file or diagonal through both
+static constexpr SquarePairTable make_between() {
+  std::array<std::array<U64, 8>, 64> rays = make_ray_attacks();
+  SquarePairTable table{};
+  for (int sq1 = 0; sq1 < 64; sq1++) {
+    for (int dir = North; dir <= NorthWest; dir++) {
+      for (int sq2 = 0; sq2 < 64; sq2++) {
+        if (rays[sq1][dir] & (1ULL << sq2)) {
+          table[sq1][sq2] = rays[sq1][dir] & ~rays[sq2][dir] & ~(1ULL << sq2);
+        }
+      }
     }
   }
-  U64 sowe = 0x0040201008040201ULL;
-  for (int f = 7; f >= 0; f--, sowe = westOne(sowe)) {
-    U64 sw = sowe;
-    for (int r8 = 56; r8 >= 0; r8 -= 8, sw >>= 8) {
-      ray_attacks[r8 + f][SouthWest] = sw;
+  return table;
+}
+
+static constexpr SquarePairTable make_line() {
+  std::array<std::array<U64, 8>, 64> rays = make_ray_attacks();
+  SquarePairTable table{};
+  for (int sq1 = 0; sq1 < 64; sq1++) {
+    for (int dir = North; dir <= NorthWest; dir++) {
+      U64 full = rays[sq1][dir] | rays[sq1][(dir + 4) % 8] | (1ULL << sq1);
+      for (int sq2 = 0; sq2 < 64; sq2++) {
+        if (rays[sq1][dir] & (1ULL << sq2)) {
+          table[sq1][sq2] = full;
+        }
+      }
     }
   }
+  return table;
 }
 
-int BitBoard::bit_scan_forward(U64 bb) {
-  assert(bb);
-  U64 debruijn64 = 0x03f79d71b4cb0a89ULL;
-  return index64[((bb ^ (bb-1)) * debruijn64) >> 58];
+constexpr SquareTable BitBoard::set_mask = make_set_mask();
+constexpr SquareTable BitBoard::clear_mask = make_clear_mask();
+constexpr std::array<std::array<U64, 8>, 64> BitBoard::ray_attacks = make_ray_attacks();
+constexpr SquareTable BitBoard::knight_moves = make_knight_moves();
+constexpr SquareTable BitBoard::king_moves = make_king_moves();
+constexpr std::array<U64, 8> BitBoard::rank = make_rank();
+constexpr std::array<U64, 8> BitBoard::file = make_file();
+constexpr SquareTable BitBoard::rank_sq = make_rank_sq();
+constexpr SquarePairTable BitBoard::between = make_between();
+constexpr SquarePairTable BitBoard::line = make_line();
+
+void BitBoard::init() {
+  popcnt_hw = popcnt_supported();
+  set_slider_backend(pext_supported() ? Pext : Magics);
+  fill_avx2 = avx2_supported();
+}
+
+bool BitBoard::pext_supported() {
+#if defined(__GNUC__) && defined(__x86_64__)
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("bmi2");
+#else
+  return false;
+#endif
 }
 
-int BitBoard::bit_scan_reverse(U64 bb) {
-  assert(bb);
-  U64 debruijn64 = 0x03f79d71b4cb0a89ULL;
-  bb |= bb >> 1;
-  bb |= bb >> 2;
-  bb |= bb >> 4;
-  bb |= bb >> 8;
-  bb |= bb >> 16;
-  bb |= bb >> 32;
-  return index64[(bb * debruijn64) >> 58];
+bool BitBoard::popcnt_supported() {
+#if defined(__GNUC__) && defined(__x86_64__)
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("popcnt");
+#else
+  return false;
+#endif
 }
 
-int BitBoard::count_bits(U64 bb) {
-  int r;
-  for (r = 0; bb; r++, bb &= bb - 1);
-  return r;
+bool BitBoard::avx2_supported() {
+#if defined(__GNUC__) && defined(__x86_64__)
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+#else
+  return false;
+#endif
+}
+
+// Both backends share the attack tables, only the index order differs, so
+// switching refills them
+void BitBoard::set_slider_backend(const SliderBackend backend) {
+  assert(backend == Magics || pext_supported());
+
+  slider_backend = backend;
+  init_magics(bishop_magics, bishop_table, bishop_magic_numbers, bishop_dirs);
+  init_magics(rook_magics, rook_table, rook_magic_numbers, rook_dirs);
+}
+
+// Ray walk used only to fill the magic tables, dirs holds two positive
+// directions followed by two negative ones
+U64 BitBoard::sliding_attacks(const int sq, const U64 &occupied, const Direction *dirs) {
+  U64 result = 0ULL;
+
+  for (int i = 0; i < 4; i++) {
+    U64 ray = ray_attacks[sq][dirs[i]];
+    U64 intersect = ray & occupied;
+    if (intersect) {
+      int blocker = (i < 2) ? bit_scan_forward(intersect) : bit_scan_reverse(intersect);
+      ray ^= ray_attacks[blocker][dirs[i]];
+    }
+    result |= ray;
+  }
+
+  return result;
+}
+
+void BitBoard::init_magics(Magic *magics, U64 *table, const U64 *magic_numbers, const Direction *dirs) {
+  U64 edges;
+  U64 occupied;
+  U64 *attacks = table;
+
+  for (int sq = 0; sq < 64; sq++) {
+    // Blockers on the board edge never change the attack set, so leave them out of the mask
+    edges = ((rank[Rank_1] | rank[Rank_8]) & ~rank[sq / 8]) |
+            ((file[File_A] | file[File_H]) & ~file[sq % 8]);
+
+    Magic &m = magics[sq];
+    m.mask = sliding_attacks(sq, 0ULL, dirs) & ~edges;
+    m.magic = magic_numbers[sq];
+    m.shift = 64 - count_bits(m.mask);
+    m.attacks = attacks;
+
+    // Carry-Rippler walk over every subset of the mask
+    occupied = 0ULL;
+    do {
+      if (slider_backend == Pext) {
+        m.attacks[pext(occupied, m.mask)] = sliding_attacks(sq, occupied, dirs);
+      }
+      else {
+        m.attacks[(occupied * m.magic) >> m.shift] = sliding_attacks(sq, occupied, dirs);
+      }
+      occupied = (occupied - m.mask) & m.mask;
+    } while (occupied);
+
+    attacks += 1ULL << count_bits(m.mask);
+  }
+
+  assert(attacks - table == ((dirs == bishop_dirs) ? 0x1480 : 0x19000));
 }
 
 void BitBoard::print_bitboard(const U64 &bb) {
@@ -171,3 +333,96 @@ void BitBoard::print_bitboard(const U64 &bb) {
   std::cout << "   " << "A  B  C  D  E  F  G  H" << std::endl;
   return;
 }
+
+// Every square attacked by a set of knights
+U64 BitBoard::knight_attacks(const U64 knights) {
+  return noNoEa(knights) | noEaEa(knights) | soEaEa(knights) | soSoEa(knights) |
+         noNoWe(knights) | noWeWe(knights) | soWeWe(knights) | soSoWe(knights);
+}
+
+/*
+ * Every square attacked by a set of rook movers and a set of bishop movers,
+ * queens belong to both. Each direction is a Kogge-Stone occluded fill, the
+ * movers are smeared along the ray through empty squares in three doubling
+ * steps and then shifted one more square onto the first blocker. The mask
+ * keeps the shifted bits from wrapping onto the other edge of the board.
+ */
+U64 BitBoard::slider_attacks(const U64 rooks, const U64 bishops, const U64 occupied) {
+  if (fill_avx2) {
+    return slider_attacks_avx2(rooks, bishops, occupied);
+  }
+  return slider_attacks_scalar(rooks, bishops, occupied);
+}
+
+static inline U64 fill_up(U64 gen, U64 pro, const int shift, const U64 mask) {
+  pro &= mask;
+  gen |= pro & (gen << shift);
+  pro &= pro << shift;
+  gen |= pro & (gen << (2 * shift));
+  pro &= pro << (2 * shift);
+  gen |= pro & (gen << (4 * shift));
+  return (gen << shift) & mask;
+}
+
+static inline U64 fill_down(U64 gen, U64 pro, const int shift, const U64 mask) {
+  pro &= mask;
+  gen |= pro & (gen >> shift);
+  pro &= pro >> shift;
+  gen |= pro & (gen >> (2 * shift));
+  pro &= pro >> (2 * shift);
+  gen |= pro & (gen >> (4 * shift));
+  return (gen >> shift) & mask;
+}
+
+U64 BitBoard::slider_attacks_scalar(const U64 rooks, const U64 bishops, const U64 occupied) {
+  U64 empty = ~occupied;
+
+  return fill_up(rooks, empty, 8, ~0ULL) | fill_down(rooks, empty, 8, ~0ULL) |
+         fill_up(rooks, empty, 1, NOT_FILE_A) | fill_down(rooks, empty, 1, NOT_FILE_H) |
+         fill_up(bishops, empty, 9, NOT_FILE_A) | fill_down(bishops, empty, 9, NOT_FILE_H) |
+         fill_up(bishops, empty, 7, NOT_FILE_H) | fill_down(bishops, empty, 7, NOT_FILE_A);
+}
+
+// The same fills with one direction per 64-bit lane, north, east, north east
+// and north west go up in one register and their opposites down in another.
+// Built for avx2 on its own so the rest of the program runs on any x86-64.
+#if defined(__GNUC__) && defined(__x86_64__)
+__attribute__((target("avx2")))
+U64 BitBoard::slider_attacks_avx2(const U64 rooks, const U64 bishops, const U64 occupied) {
+  const __m256i shift1 = _mm256_setr_epi64x(8, 1, 9, 7);
+  const __m256i shift2 = _mm256_add_epi64(shift1, shift1);
+  const __m256i shift4 = _mm256_add_epi64(shift2, shift2);
+  const __m256i up_mask = _mm256_setr_epi64x(~0ULL, NOT_FILE_A, NOT_FILE_A, NOT_FILE_H);
+  const __m256i down_mask = _mm256_setr_epi64x(~0ULL, NOT_FILE_H, NOT_FILE_H, NOT_FILE_A);
+
+  __m256i empty = _mm256_set1_epi64x(~occupied);
+  __m256i movers = _mm256_setr_epi64x(rooks, rooks, bishops, bishops);
+
+  __m256i gen = movers;
+  __m256i pro = _mm256_and_si256(empty, up_mask);
+  gen = _mm256_or_si256(gen, _mm256_and_si256(pro, _mm256_sllv_epi64(gen, shift1)));
+  pro = _mm256_and_si256(pro, _mm256_sllv_epi64(pro, shift1));
+  gen = _mm256_or_si256(gen, _mm256_and_si256(pro, _mm256_sllv_epi64(gen, shift2)));
+  pro = _mm256_and_si256(pro, _mm256_sllv_epi64(pro, shift2));
+  gen = _mm256_or_si256(gen, _mm256_and_si256(pro, _mm256_sllv_epi64(gen, shift4)));
+  __m256i up = _mm256_and_si256(_mm256_sllv_epi64(gen, shift1), up_mask);
+
+  gen = movers;
+  pro = _mm256_and_si256(empty, down_mask);
+  gen = _mm256_or_si256(gen, _mm256_and_si256(pro, _mm256_srlv_epi64(gen, shift1)));
+  pro = _mm256_and_si256(pro, _mm256_srlv_epi64(pro, shift1));
+  gen = _mm256_or_si256(gen, _mm256_and_si256(pro, _mm256_srlv_epi64(gen, shift2)));
+  pro = _mm256_and_si256(pro, _mm256_srlv_epi64(pro, shift2));
+  gen = _mm256_or_si256(gen, _mm256_and_si256(pro, _mm256_srlv_epi64(gen, shift4)));
+  __m256i down = _mm256_and_si256(_mm256_srlv_epi64(gen, shift1), down_mask);
+
+  __m256i all = _mm256_or_si256(up, down);
+  __m128i half = _mm_or_si128(_mm256_castsi256_si128(all), _mm256_extracti128_si256(all, 1));
+  return _mm_cvtsi128_si64(half) | _mm_extract_epi64(half, 1);
+}
+#else
+U64 BitBoard::slider_attacks_avx2(const U64 rooks, const U64 bishops, const U64 occupied) {
+  assert(false);
+  return slider_attacks_scalar(rooks, bishops, occupied);
+}
+#endif
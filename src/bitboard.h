@@ -1,7 +1,16 @@
 #pragma once
 
+#include <cassert>
+#include <array>
+
 typedef unsigned long long U64;
 
+#define NOT_FILE_A 0xFEFEFEFEFEFEFEFEULL
+#define NOT_FILE_H 0x7F7F7F7F7F7F7F7FULL
+
+typedef std::array<U64, 64> SquareTable;
+typedef std::array<SquareTable, 64> SquarePairTable;
+
 enum Square {
   A1, B1, C1, D1, E1, F1, G1, H1,
   A2, B2, C2, D2, E2, F2, G2, H2,
@@ -29,12 +38,24 @@ enum File {
   File_A, File_B, File_C, File_D, File_E, File_F, File_G, File_H
 };
 
+enum SliderBackend {
+  Magics, Pext
+};
+
+typedef struct {
+  U64 mask;
+  U64 magic;
+  U64 *attacks;
+  int shift;
+} Magic;
+
 class BitBoard {
 public:
   static void init();
   static int bit_scan_forward(U64 bb);
   static int bit_scan_reverse(U64 bb);
   static int count_bits(U64 bb);
+  static int pop_lsb(U64 &bb);
   static void print_bitboard(const U64 &bb);
 
   static U64 noEaOne(const U64 &bb);
@@ -42,12 +63,131 @@ public:
   static U64 soEaOne(const U64 &bb);
   static U64 soWeOne(const U64 &bb);
 
-  static U64 set_mask[64];
-  static U64 clear_mask[64];
-  static U64 ray_attacks[64][8];
-  static U64 knight_moves[64];
-  static U64 king_moves[64];
-  static U64 rank[8];
-  static U64 file[8];
-  static U64 rank_sq[64];
+  static U64 bishop_attacks(const int sq, const U64 &occupied);
+  static U64 rook_attacks(const int sq, const U64 &occupied);
+  static bool pext_supported();
+  static void set_slider_backend(const SliderBackend backend);
+
+  static U64 knight_attacks(const U64 knights);
+  static U64 slider_attacks(const U64 rooks, const U64 bishops, const U64 occupied);
+  static bool avx2_supported();
+  static bool popcnt_supported();
+
+  static const SquareTable set_mask;
+  static const SquareTable clear_mask;
+  static const std::array<std::array<U64, 8>, 64> ray_attacks;
+  static const SquareTable knight_moves;
+  static const SquareTable king_moves;
+  static const std::array<U64, 8> rank;
+  static const std::array<U64, 8> file;
+  static const SquareTable rank_sq;
+  static const SquarePairTable between;
+  static const SquarePairTable line;
+  static Magic bishop_magics[64];
+  static Magic rook_magics[64];
+  static SliderBackend slider_backend;
+  static const char *slider_backend_names[2];
+  static bool fill_avx2;
+  static bool popcnt_hw;
+private:
+  static const int index64[64];
+  static U64 pext(const U64 bb, const U64 mask);
+  static void init_magics(Magic *magics, U64 *table, const U64 *magic_numbers, const Direction *dirs);
+  static U64 sliding_attacks(const int sq, const U64 &occupied, const Direction *dirs);
+  static U64 slider_attacks_scalar(const U64 rooks, const U64 bishops, const U64 occupied);
+  static U64 slider_attacks_avx2(const U64 rooks, const U64 bishops, const U64 occupied);
+  static U64 bishop_table[0x1480];
+  static U64 rook_table[0x19000];
 };
+
+// The scan builtins are bsf/bsr on any x86-64, the De Bruijn versions are kept
+// for other compilers
+inline int BitBoard::bit_scan_forward(U64 bb) {
+  assert(bb);
+#if defined(__GNUC__)
+  return __builtin_ctzll(bb);
+#else
+  U64 debruijn64 = 0x03f79d71b4cb0a89ULL;
+  return index64[((bb ^ (bb-1)) * debruijn64) >> 58];
+#endif
+}
+
+inline int BitBoard::bit_scan_reverse(U64 bb) {
+  assert(bb);
+#if defined(__GNUC__)
+  return 63 ^ __builtin_clzll(bb);
+#else
+  U64 debruijn64 = 0x03f79d71b4cb0a89ULL;
+  bb |= bb >> 1;
+  bb |= bb >> 2;
+  bb |= bb >> 4;
+  bb |= bb >> 8;
+  bb |= bb >> 16;
+  bb |= bb >> 32;
+  return index64[(bb * debruijn64) >> 58];
+#endif
+}
+
+// Without -mpopcnt __builtin_popcountll is a libgcc call, so like pext the
+// instruction is emitted by inline asm once cpuid reported it
+inline int BitBoard::count_bits(U64 bb) {
+#if defined(__GNUC__) && defined(__x86_64__)
+  if (popcnt_hw) {
+    U64 result;
+    asm("popcntq %1, %0" : "=r" (result) : "r" (bb));
+    return (int) result;
+  }
+  return __builtin_popcountll(bb);
+#elif defined(__GNUC__)
+  return __builtin_popcountll(bb);
+#else
+  int r;
+  for (r = 0; bb; r++, bb &= bb - 1);
+  return r;
+#endif
+}
+
+// Returns the least significant square and clears it from bb
+inline int BitBoard::pop_lsb(U64 &bb) {
+  int sq = bit_scan_forward(bb);
+  bb &= bb - 1;
+  return sq;
+}
+
+// One step diagonal shifts of a whole set, squares leaving the board are dropped
+inline U64 BitBoard::noEaOne(const U64 &bb) { return (bb & NOT_FILE_H) << 9; }
+inline U64 BitBoard::noWeOne(const U64 &bb) { return (bb & NOT_FILE_A) << 7; }
+inline U64 BitBoard::soEaOne(const U64 &bb) { return (bb & NOT_FILE_H) >> 7; }
+inline U64 BitBoard::soWeOne(const U64 &bb) { return (bb & NOT_FILE_A) >> 9; }
+
+// Inline asm rather than the intrinsic so the instruction can be emitted
+// without building for bmi2, it is only reached once cpuid reported support
+inline U64 BitBoard::pext(const U64 bb, const U64 mask) {
+#if defined(__GNUC__) && defined(__x86_64__)
+  U64 result;
+  asm("pextq %2, %1, %0" : "=r" (result) : "r" (bb), "r" (mask));
+  return result;
+#else
+  assert(false);
+  return 0ULL;
+#endif
+}
+
+// Fancy magic lookup, the occupancy bits relevant to the slider are hashed to an
+// index into the square's slice of the shared attack table. With the Pext backend
+// the same slice is indexed by extracting those bits directly.
+inline U64 BitBoard::bishop_attacks(const int sq, const U64 &occupied) {
+  const Magic &m = bishop_magics[sq];
+  if (slider_backend == Pext) {
+    return m.attacks[pext(occupied, m.mask)];
+  }
+  return m.attacks[((occupied & m.mask) * m.magic) >> m.shift];
+}
+
+inline U64 BitBoard::rook_attacks(const int sq, const U64 &occupied) {
+  const Magic &m = rook_magics[sq];
+  if (slider_backend == Pext) {
+    return m.attacks[pext(occupied, m.mask)];
+  }
+  return m.attacks[((occupied & m.mask) * m.magic) >> m.shift];
+}
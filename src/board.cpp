@@ -3,7 +3,7 @@
 
 #include "board.h"
 #include "zobrist.h"
-#include "pvtable.h"
+#include "evaluate.h"
 
 void Board::init() {
   reset();
@@ -26,24 +26,43 @@ void Board::init() {
                  pieces[Black_Rooks] | pieces[Black_Queens] | pieces[Black_King];
   pieces[All_Pieces] = pieces[White_Pieces] | pieces[Black_Pieces];
 
-  generate_position_key(*this);
+  for (int piece = White_Pawns; piece <= Black_King; piece++) {
+    U64 bb = pieces[piece];
+    while (bb) {
+      piece_on[BitBoard::pop_lsb(bb)] = piece;
+    }
+  }
+
   enpassant = NOSQ;
   castle_perm = 0xF;
   history_ply = 0;
   ply = 0;
   side = White;
+
+  // The key covers side, castling and en passant, so it comes after them
+  generate_position_key();
+  material = Evaluator::get_material_score(*this);
+  pst_score = Evaluator::get_pst_score(*this);
+#ifdef ATTACK_MAPS
+  refresh_attacks();
+#endif
 }
 
 void Board::reset() {
   for (int i = 0; i < 16; i++) {
     pieces[i] = 0ULL;
   }
+  for (int sq = 0; sq < 64; sq++) {
+    piece_on[sq] = None;
+  }
   fifty_move = 0;
   history_ply = 0;
   ply = 0;
   castle_perm = 0;
   enpassant = NOSQ;
   position_key = 0ULL;
+  material = 0;
+  pst_score = 0;
 }
 
 const Color piece_color[13] = { 
@@ -119,6 +138,7 @@ int Board::parse_fen(char *fen) {
       sq64 = rank * 8 + file;
       U64 bb = 1ULL << sq64;
       if (piece != None) {
+        piece_on[sq64] = piece;
         pieces[piece] |= bb;
         pieces[All_Pieces] |= bb;
         if (piece_color[piece] == White) {
@@ -166,21 +186,24 @@ int Board::parse_fen(char *fen) {
     std::cout << "enpassant is " << enpassant << std::endl;
   }
 
-  generate_position_key(*this);
+  generate_position_key();
+  material = Evaluator::get_material_score(*this);
+  pst_score = Evaluator::get_pst_score(*this);
+#ifdef ATTACK_MAPS
+  refresh_attacks();
+#endif
 
   return 0;
 }
 
-void Board::generate_position_key(Board board) {
+void Board::generate_position_key() {
   position_key = 0ULL;
 
   for (int i = 1; i < 13; i++) {
-    while (board.pieces[i]) {
-      if (board.pieces[i] != 0ULL) {
-        int sq = BitBoard::bit_scan_forward(board.pieces[i]);
-        position_key ^= Zobrist::piece_keys[i][sq];
-        board.pieces[i] &= BitBoard::clear_mask[sq];
-      }
+    U64 bb = pieces[i];
+    while (bb) {
+      int sq = BitBoard::pop_lsb(bb);
+      position_key ^= Zobrist::piece_keys[i][sq];
     }
   }
 
@@ -188,13 +211,47 @@ void Board::generate_position_key(Board board) {
     position_key ^= Zobrist::side_key;
   }
 
-  if (enpassant == NOSQ) {
+  // The same key make_move hashes the en passant square with
+  if (enpassant != NOSQ) {
     position_key ^= Zobrist::piece_keys[None][enpassant];
   }
 
   position_key ^= Zobrist::castle_keys[castle_perm];
 }
 
+#ifdef ATTACK_MAPS
+// Attack maps built from scratch, make_move and take_move only touch the
+// pieces a move can affect
+void Board::refresh_attacks() {
+  U64 occupied = pieces[All_Pieces];
+  attacks[White] = attacks[Black] = 0ULL;
+
+  for (int sq = 0; sq < 64; sq++) {
+    attacks_from[sq] = (piece_on[sq] == None) ? 0ULL : piece_attacks(piece_on[sq], sq, occupied);
+    if (piece_on[sq] != None) {
+      attacks[piece_color[piece_on[sq]]] |= attacks_from[sq];
+    }
+  }
+}
+
+U64 Board::piece_attacks(const int piece, const int sq, const U64 &occupied) {
+  U64 bb = BitBoard::set_mask[sq];
+
+  switch (piece) {
+    case White_Pawns: return BitBoard::noWeOne(bb) | BitBoard::noEaOne(bb);
+    case Black_Pawns: return BitBoard::soWeOne(bb) | BitBoard::soEaOne(bb);
+    case White_Knights: case Black_Knights: return BitBoard::knight_moves[sq];
+    case White_Bishops: case Black_Bishops: return BitBoard::bishop_attacks(sq, occupied);
+    case White_Rooks: case Black_Rooks: return BitBoard::rook_attacks(sq, occupied);
+    case White_Queens: case Black_Queens:
+      return BitBoard::bishop_attacks(sq, occupied) | BitBoard::rook_attacks(sq, occupied);
+    case White_King: case Black_King: return BitBoard::king_moves[sq];
+  }
+
+  return 0ULL;
+}
+#endif
+
 void Board::print_board() {
   int rank[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
   for (int i = 56; i >= 0; i -= 8) {
@@ -17,27 +17,54 @@ enum CastlePerm {
   WKCA = 1, WQCA = 2, BKCA = 4, BQCA = 8
 };
 
+// Everything make_move can not recover from the move itself, packed into
+// 16 bytes as the game history holds one per move
 typedef struct {
-  int move, castle_perm, enpassant, fifty_move;
   U64 position_key;
+  unsigned short move, fifty_move;
+  unsigned char castle_perm, enpassant, captured;
+#ifdef ATTACK_MAPS
+  U64 attacks[2];
+#endif
 } Undo;
 
-class Board {
+// The part of the board a move changes, copied whole in copy-make mode
+typedef struct {
+  U64 pieces[16];
+  unsigned char piece_on[64];
+  U64 position_key;
+  int enpassant, castle_perm, fifty_move;
+  Color side;
+  // Material and piece-square sums from white's side
+  int material, pst_score;
+#ifdef ATTACK_MAPS
+  // Squares attacked by each color and by the piece on each square, kept up
+  // to date by make_move and take_move
+  U64 attacks[2];
+  U64 attacks_from[64];
+#endif
+} Position;
+
+// The moves played so far, to take them back and to find repetitions
+typedef struct {
+  Undo history[MAX_GAME_MOVES];
+  int history_ply;
+} GameHistory;
+
+// Search heuristics live in a SearchContext of each searching thread
+class Board : public Position, public GameHistory {
 public:
   void init();
   void reset();
   int parse_fen(char *fen);
-  U64 pieces[16];
-  U64 position_key;
-  int enpassant, castle_perm, fifty_move, ply, history_ply;
-  Color side;
+  int ply;
+#ifdef ATTACK_MAPS
+  void refresh_attacks();
+  static U64 piece_attacks(const int piece, const int sq, const U64 &occupied);
+#endif
   void print_board();
-  Undo history[MAX_GAME_MOVES];
-  int pv_array[MAXDEPTH];
-  int search_history[13][64];
-  int search_killers[2][MAXDEPTH];
 private:
-  void generate_position_key(Board board);
+  void generate_position_key();
 };
 
 extern const Color piece_color[13];
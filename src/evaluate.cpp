@@ -1,7 +1,9 @@
+#include <cassert>
+
 #include "evaluate.h"
 #include "bitboard.h"
 
-static const int PawnTable[64] = {
+static constexpr int PawnTable[64] = {
   0, 0, 0, 0, 0, 0, 0, 0, 
   10, 10, 0, -10, -10, 0, 10, 10, 
   5, 0, 0, 5, 5, 0, 0, 5, 
@@ -12,7 +14,7 @@ static const int PawnTable[64] = {
   0, 0, 0, 0, 0, 0, 0, 0
 };
 
-static const int KnightTable[64] = {
+static constexpr int KnightTable[64] = {
   0, -10, 0, 0, 0, 0, -10, 0, 
   0, 0, 0, 5, 5, 0, 0, 0, 
   0, 0, 10, 10, 10, 10, 0, 0, 
@@ -23,7 +25,7 @@ static const int KnightTable[64] = {
   0, 0, 0, 0, 0, 0, 0, 0
 };
 
-static const int BishopTable[64] = {
+static constexpr int BishopTable[64] = {
   0, 0, -10, 0, 0, -10, 0, 0, 
   0, 0, 0, 10, 10, 0, 0, 0, 
   0, 0, 10, 15, 15, 10, 0, 0, 
@@ -34,7 +36,7 @@ static const int BishopTable[64] = {
   0, 0, 0, 0, 0, 0, 0, 0
 };
 
-static const int RookTable[64] = {
+static constexpr int RookTable[64] = {
   0, 0, 5, 10, 10, 5, 0, 0, 
   0, 0, 5, 10, 10, 5, 0, 0, 
   0, 0, 5, 10, 10, 5, 0, 0, 
@@ -45,7 +47,7 @@ static const int RookTable[64] = {
   0, 0, 5, 10, 10, 5, 0, 0
 };
 
-static const int Mirror64[64] = {
+static constexpr int Mirror64[64] = {
   56, 57, 58, 59, 60, 61, 62, 63, 
   48, 49, 50, 51, 52, 53, 54, 55, 
   40, 41, 42, 43, 44, 45, 46, 47, 
@@ -56,76 +58,104 @@ static const int Mirror64[64] = {
   0, 1, 2, 3, 4, 5, 6, 7
 };
 
-static const int PieceVal[13] = 
-  { 0, 100, 325, 325, 550, 1000, 50000, 100, 325, 325, 550, 1000, 50000 };
+static constexpr const int *piece_table[7] = {
+  nullptr, PawnTable, KnightTable, BishopTable, RookTable, nullptr, nullptr
+};
+
+constexpr int piece_value[13] =
+  { 0, 100, 325, 325, 550, 1000, 50000, -100, -325, -325, -550, -1000, -50000 };
+
+// Queens and kings have no table, black pieces use the white tables mirrored
+static constexpr std::array<std::array<int, 64>, 13> make_pst_value() {
+  std::array<std::array<int, 64>, 13> values{};
+  for (int piece = White_Pawns; piece <= Black_King; piece++) {
+    bool white = piece <= White_King;
+    const int *table = piece_table[white ? piece : piece - 6];
+    for (int sq = 0; sq < 64; sq++) {
+      if (table) {
+        values[piece][sq] = white ? table[sq] : -table[Mirror64[sq]];
+      }
+    }
+  }
+  return values;
+}
+
+constexpr std::array<std::array<int, 64>, 13> pst_value = make_pst_value();
+
+// The material and piece-square scores are kept up to date by make_move and
+// take_move, both from white's side
+int Evaluator::evaluate_positon(const Board &board) {
+  assert(board.material == get_material_score(board));
+  assert(board.pst_score == get_pst_score(board));
+
+  int score = board.material + board.pst_score;
+
+  if (board.side == White) {
+    return score;
+  }
+  return -score;
+}
 
-int Evaluator::evaluate_positon(Board board) {
-  int score = get_material_score(board);
+int Evaluator::get_pst_score(const Board &board) {
+  int score = 0;
+  U64 bb;
 
-  while (board.pieces[White_Pawns]) {
-    int sq = BitBoard::bit_scan_forward(board.pieces[White_Pawns]);
+  bb = board.pieces[White_Pawns];
+  while (bb) {
+    int sq = BitBoard::pop_lsb(bb);
     score += PawnTable[sq];
-    board.pieces[White_Pawns] &= BitBoard::clear_mask[sq];
   }
 
-  while (board.pieces[White_Knights]) {
-    int sq = BitBoard::bit_scan_forward(board.pieces[White_Knights]);
+  bb = board.pieces[White_Knights];
+  while (bb) {
+    int sq = BitBoard::pop_lsb(bb);
     score += KnightTable[sq];
-    board.pieces[White_Knights] &= BitBoard::clear_mask[sq];
   }
 
-  while (board.pieces[White_Bishops]) {
-    int sq = BitBoard::bit_scan_forward(board.pieces[White_Bishops]);
+  bb = board.pieces[White_Bishops];
+  while (bb) {
+    int sq = BitBoard::pop_lsb(bb);
     score += BishopTable[sq];
-    board.pieces[White_Bishops] &= BitBoard::clear_mask[sq];
   }
 
-  while (board.pieces[White_Rooks]) {
-    int sq = BitBoard::bit_scan_forward(board.pieces[White_Rooks]);
+  bb = board.pieces[White_Rooks];
+  while (bb) {
+    int sq = BitBoard::pop_lsb(bb);
     score += RookTable[sq];
-    board.pieces[White_Rooks] &= BitBoard::clear_mask[sq];
   }
 
-  while (board.pieces[Black_Pawns]) {
-    int sq = BitBoard::bit_scan_forward(board.pieces[Black_Pawns]);
+  bb = board.pieces[Black_Pawns];
+  while (bb) {
+    int sq = BitBoard::pop_lsb(bb);
     score -= PawnTable[Mirror64[sq]];
-    board.pieces[Black_Pawns] &= BitBoard::clear_mask[sq];
   }
 
-  while (board.pieces[Black_Knights]) {
-    int sq = BitBoard::bit_scan_forward(board.pieces[Black_Knights]);
+  bb = board.pieces[Black_Knights];
+  while (bb) {
+    int sq = BitBoard::pop_lsb(bb);
     score -= KnightTable[Mirror64[sq]];
-    board.pieces[Black_Knights] &= BitBoard::clear_mask[sq];
   }
 
-  while (board.pieces[Black_Bishops]) {
-    int sq = BitBoard::bit_scan_forward(board.pieces[Black_Bishops]);
+  bb = board.pieces[Black_Bishops];
+  while (bb) {
+    int sq = BitBoard::pop_lsb(bb);
     score -= BishopTable[Mirror64[sq]];
-    board.pieces[Black_Bishops] &= BitBoard::clear_mask[sq];
   }
 
-  while (board.pieces[Black_Rooks]) {
-    int sq = BitBoard::bit_scan_forward(board.pieces[Black_Rooks]);
+  bb = board.pieces[Black_Rooks];
+  while (bb) {
+    int sq = BitBoard::pop_lsb(bb);
     score -= RookTable[Mirror64[sq]];
-    board.pieces[Black_Rooks] &= BitBoard::clear_mask[sq];
   }
 
-  if (board.side == White) {
-    return score;
-  }
-  return -score;
+  return score;
 }
 
 int Evaluator::get_material_score(const Board &board) {
-  int white_material = 0;
-  int black_material = 0;
-  for (int i = 1; i < 7; i++) {
-    int num_white_piece = BitBoard::count_bits(board.pieces[i]);
-    int num_black_piece = BitBoard::count_bits(board.pieces[i + 6]);
-
-    white_material += num_white_piece * PieceVal[i];
-    black_material += num_black_piece * PieceVal[i + 6]; 
+  int material = 0;
+  for (int i = White_Pawns; i <= Black_King; i++) {
+    material += BitBoard::count_bits(board.pieces[i]) * piece_value[i];
   }
 
-  return white_material - black_material;
+  return material;
 }
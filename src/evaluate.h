@@ -1,10 +1,16 @@
 #pragma once
 
+#include <array>
 #include "board.h"
 
 class Evaluator {
 public:
-  static int evaluate_positon(Board board);
-private:
+  static int evaluate_positon(const Board &board);
   static int get_material_score(const Board &board);
+  static int get_pst_score(const Board &board);
 };
+
+// Signed from white's side, what a piece adds to Board::material and, on a
+// square, to Board::pst_score
+extern const int piece_value[13];
+extern const std::array<std::array<int, 64>, 13> pst_value;
@@ -1,18 +1,18 @@
 #include <iostream>
 
 #include "movegen.h"
-#include "zobrist.h"
 #include "evaluate.h"
+#include "search.h"
 #include "uci.h"
 
 int main(int argc, const char *argv[]) {
   std::cout << "BKChess Started!" << std::endl;
   BitBoard::init();
-  Zobrist::init();
-  MoveGenerator::init();
+  Searcher::init();
 
   Board board;
   SearchInfo info;
+  board.init();
 
   Uci::loop(board, info);
 
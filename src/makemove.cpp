@@ -4,6 +4,7 @@
 #include "movegen.h"
 #include "makemove.h"
 #include "zobrist.h"
+#include "evaluate.h"
 
 #define HASH_PCE(pce, sq) (board.position_key ^= Zobrist::piece_keys[(pce)][(sq)])
 #define HASH_CA (board.position_key ^= (Zobrist::castle_keys[(board.castle_perm)]))
@@ -21,7 +22,14 @@ static const int castle_perm[64] = {
    7, 15, 15, 15,  3, 15, 15, 11 
 };
 
-bool MoveMaker::make_move(Board &board, const int move) {
+// With copy_make set make_move saves the whole Position before changing it and
+// take_move copies it back instead of undoing the move piece by piece
+bool MoveMaker::copy_make = false;
+thread_local Position MoveMaker::saved[MAX_GAME_MOVES];
+
+// Moves are expected to come from the legal move generator, so the king of
+// the side that moved is never left in check
+void MoveMaker::make_move(Board &board, const int move) {
   int from = FROM_SQUARE(move);
   int to = TO_SQUARE(move);
   int side = board.side;
@@ -29,15 +37,17 @@ bool MoveMaker::make_move(Board &board, const int move) {
   assert(from >= 0 && from < 64);
   assert(to >= 0 && to < 64);
 
+  if (copy_make) {
+    saved[board.history_ply] = board;
+  }
+
   board.history[board.history_ply].position_key = board.position_key;  
 
+  int captured = board.piece_on[to];
   if (MOVE_TYPE(move) == EnPassant) {
-    if (side == White) {
-      clear_piece(to - 8, board);
-    }
-    else {
-      clear_piece(to + 8, board);
-    }
+    int cap_sq = (side == White) ? to - 8 : to + 8;
+    captured = board.piece_on[cap_sq];
+    clear_piece(cap_sq, board);
   }
   else if (MOVE_TYPE(move) == Castle) {
     switch(to) {
@@ -66,6 +76,7 @@ bool MoveMaker::make_move(Board &board, const int move) {
   board.history[board.history_ply].fifty_move = board.fifty_move;
   board.history[board.history_ply].enpassant = board.enpassant;
   board.history[board.history_ply].castle_perm = board.castle_perm;
+  board.history[board.history_ply].captured = captured;
 
   board.castle_perm &= castle_perm[from];
   board.castle_perm &= castle_perm[to];
@@ -75,27 +86,25 @@ bool MoveMaker::make_move(Board &board, const int move) {
   
   board.fifty_move++;
 
-  int captured = PIECE_CAPTURED(move);
   if (captured != None) {
-    clear_piece(to, board);
+    if (MOVE_TYPE(move) != EnPassant) {
+      clear_piece(to, board);
+    }
     board.fifty_move = 0;
   }
 
   board.history_ply++;
   board.ply++;
 
-  int king_index;
   int pawn_start_shift;
   int pawn_enpassant_shift;
   Piece side_pawns;
   if (side == White) {
-    king_index = White_King;
     pawn_start_shift = 16;
     pawn_enpassant_shift = 8;
     side_pawns = White_Pawns;
   }
   else {
-    king_index = Black_King;
     pawn_start_shift = -16;
     pawn_enpassant_shift = -8;
     side_pawns = Black_Pawns;
@@ -111,24 +120,32 @@ bool MoveMaker::make_move(Board &board, const int move) {
 
   move_piece(from, to, board);
 
-  int promoted_piece = PIECE_PROMOTED(move);
-  if (promoted_piece != 0) {
+  if (MOVE_TYPE(move) == Promotion) {
     clear_piece(to, board);
-    add_piece(to, board, promoted_piece);
+    add_piece(to, board, side_pawns + 1 + PROMOTION_PIECE(move));
   }
 
   board.side = (board.side == White) ? Black : White;
   HASH_SIDE;
 
-  assert(board.pieces[king_index] != 0ULL);
-
-  if (MoveGenerator::square_attacked(int_to_square[BitBoard::bit_scan_forward(board.pieces[king_index])], 
-                                     board.side, board)) {
-    take_move(board);
-    return false;
+#ifdef ATTACK_MAPS
+  board.history[board.history_ply - 1].attacks[White] = board.attacks[White];
+  board.history[board.history_ply - 1].attacks[Black] = board.attacks[Black];
+  // The side to move now only needs a new map when a capture or one of its
+  // sliders seeing the move changed it, take_move restores both from history
+  U64 touched = update_attacks(board, changed_squares(move, (Color)side));
+  rebuild_attacks(board, (Color)side);
+  if (captured != None || (touched & board.pieces[(side == White) ? Black_Pieces : White_Pieces])) {
+    rebuild_attacks(board, board.side);
   }
-  
-  return true;
+  assert(board.attacks[White] == MoveGenerator::attacks_by(board, White, board.pieces[All_Pieces]));
+  assert(board.attacks[Black] == MoveGenerator::attacks_by(board, Black, board.pieces[All_Pieces]));
+#endif
+
+  assert(board.pieces[(side == White) ? White_King : Black_King] != 0ULL);
+  assert(!MoveGenerator::square_attacked(
+      int_to_square[BitBoard::bit_scan_forward(board.pieces[(side == White) ? White_King : Black_King])], board.side,
+      board));
 }
 
 void MoveMaker::take_move(Board &board) {
@@ -137,6 +154,11 @@ void MoveMaker::take_move(Board &board) {
   board.history_ply--;
   board.ply--;
 
+  if (copy_make) {
+    static_cast<Position &>(board) = saved[board.history_ply];
+    return;
+  }
+
   int move = board.history[board.history_ply].move;
   int from = FROM_SQUARE(move);
   int to = TO_SQUARE(move);
@@ -187,30 +209,142 @@ void MoveMaker::take_move(Board &board) {
 
   move_piece(to, from, board);
 
-  int captured = PIECE_CAPTURED(move);
-  if (captured != 0) {
-    if (MOVE_TYPE(move) != 1) {
+  int captured = board.history[board.history_ply].captured;
+  if (captured != None) {
+    if (MOVE_TYPE(move) != EnPassant) {
       add_piece(to, board, captured);
     }
   }
 
-  int promoted_piece = PIECE_PROMOTED(move);
-  if (promoted_piece != None) {
+  if (MOVE_TYPE(move) == Promotion) {
     clear_piece(from, board);
-    add_piece(from, board, (piece_color[promoted_piece] == White ? White_Pawns : Black_Pawns));
+    add_piece(from, board, (board.side == White) ? White_Pawns : Black_Pawns);
   }
+
+#ifdef ATTACK_MAPS
+  update_attacks(board, changed_squares(move, board.side));
+  board.attacks[White] = board.history[board.history_ply].attacks[White];
+  board.attacks[Black] = board.history[board.history_ply].attacks[Black];
+#endif
 }
 
-void MoveMaker::clear_piece(const int sq, Board &board) {
-  assert(board.pieces != NULL);
+// Passes the move to the other side. The fifty move count starts over so
+// repetitions are not looked for across the null move. Nothing moves, so
+// the same code serves copy-make and the attack maps stay as they are.
+void MoveMaker::make_null_move(Board &board) {
+  assert(board.history_ply < MAX_GAME_MOVES && board.ply < MAXDEPTH);
+
+  board.history[board.history_ply].position_key = board.position_key;
+  board.history[board.history_ply].move = NOMOVE;
+  board.history[board.history_ply].fifty_move = board.fifty_move;
+  board.history[board.history_ply].enpassant = board.enpassant;
+  board.history[board.history_ply].castle_perm = board.castle_perm;
+  board.history[board.history_ply].captured = None;
+#ifdef ATTACK_MAPS
+  board.history[board.history_ply].attacks[White] = board.attacks[White];
+  board.history[board.history_ply].attacks[Black] = board.attacks[Black];
+#endif
+
+  if (board.enpassant != NOSQ) HASH_EP;
+  board.enpassant = NOSQ;
+  board.fifty_move = 0;
+
+  board.side = (board.side == White) ? Black : White;
+  HASH_SIDE;
+
+  board.history_ply++;
+  board.ply++;
+}
+
+void MoveMaker::take_null_move(Board &board) {
+  assert(board.history_ply != 0 && board.ply != 0);
+
+  board.history_ply--;
+  board.ply--;
+
+  assert(board.history[board.history_ply].move == NOMOVE);
 
-  U64 clear_mask = BitBoard::clear_mask[sq];
-  for (int i = 0; i < 16; i++) {
-    if (i >= 1 && i < 13 && (board.pieces[i] & (1ULL << sq))) {
-      HASH_PCE(i, sq);
+  board.side = (board.side == White) ? Black : White;
+  board.enpassant = board.history[board.history_ply].enpassant;
+  board.fifty_move = board.history[board.history_ply].fifty_move;
+  board.position_key = board.history[board.history_ply].position_key;
+}
+
+#ifdef ATTACK_MAPS
+// Every square whose occupant differs before and after move
+U64 MoveMaker::changed_squares(const int move, const Color side) {
+  int from = FROM_SQUARE(move);
+  int to = TO_SQUARE(move);
+  U64 changed = BitBoard::set_mask[from] | BitBoard::set_mask[to];
+
+  if (MOVE_TYPE(move) == EnPassant) {
+    changed |= BitBoard::set_mask[(side == White) ? to - 8 : to + 8];
+  }
+  else if (MOVE_TYPE(move) == Castle) {
+    changed |= (to > from) ? BitBoard::set_mask[from + 3] | BitBoard::set_mask[from + 1]
+                           : BitBoard::set_mask[from - 4] | BitBoard::set_mask[from - 1];
+  }
+
+  return changed;
+}
+
+/*
+ * Only the pieces standing on a changed square and the sliders whose rays
+ * reached one need new attacks. A ray that reaches a changed square after the
+ * move already reached the first changed square on it before, so testing the
+ * old attacks finds every slider. Returns the squares whose attacks were redone.
+ */
+U64 MoveMaker::update_attacks(Board &board, const U64 changed) {
+  U64 occupied = board.pieces[All_Pieces];
+  U64 sliders = (board.pieces[White_Bishops] | board.pieces[White_Rooks] | board.pieces[White_Queens] |
+                 board.pieces[Black_Bishops] | board.pieces[Black_Rooks] | board.pieces[Black_Queens]) & ~changed;
+  U64 touched = changed;
+
+  while (sliders) {
+    int sq = BitBoard::pop_lsb(sliders);
+    if (board.attacks_from[sq] & changed) {
+      board.attacks_from[sq] = Board::piece_attacks(board.piece_on[sq], sq, occupied);
+      touched |= BitBoard::set_mask[sq];
     }
-    board.pieces[i] &= clear_mask;
   }
+
+  U64 squares = changed;
+  while (squares) {
+    int sq = BitBoard::pop_lsb(squares);
+    board.attacks_from[sq] = (board.piece_on[sq] == None) ? 0ULL :
+                             Board::piece_attacks(board.piece_on[sq], sq, occupied);
+  }
+
+  return touched;
+}
+
+void MoveMaker::rebuild_attacks(Board &board, const Color color) {
+  U64 attacks = 0ULL;
+  U64 pieces = board.pieces[(color == White) ? White_Pieces : Black_Pieces];
+  while (pieces) {
+    attacks |= board.attacks_from[BitBoard::pop_lsb(pieces)];
+  }
+  board.attacks[color] = attacks;
+}
+#endif
+
+void MoveMaker::clear_piece(const int sq, Board &board) {
+  assert(sq >= 0 && sq < 64);
+
+  int piece = board.piece_on[sq];
+  assert(piece != None);
+
+  Piece side_pieces = (piece_color[piece] == White) ? White_Pieces : Black_Pieces;
+
+  HASH_PCE(piece, sq);
+  board.material -= piece_value[piece];
+  board.pst_score -= pst_value[piece][sq];
+
+  U64 mask = BitBoard::clear_mask[sq];
+  board.pieces[piece] &= mask;
+  board.pieces[side_pieces] &= mask;
+  board.pieces[All_Pieces] &= mask;
+  board.piece_on[sq] = None;
 }
 
 void MoveMaker::add_piece(const int sq, Board &board, const int piece) {
@@ -219,11 +353,14 @@ void MoveMaker::add_piece(const int sq, Board &board, const int piece) {
   Piece side_pieces = (piece_color[piece] == White) ? White_Pieces : Black_Pieces;
 
   HASH_PCE(piece, sq);
+  board.material += piece_value[piece];
+  board.pst_score += pst_value[piece][sq];
 
   U64 mask = BitBoard::set_mask[sq];
   board.pieces[piece] |= mask;
   board.pieces[side_pieces] |= mask;
   board.pieces[All_Pieces] |= mask;
+  board.piece_on[sq] = piece;
 }
 
 void MoveMaker::move_piece(const int from, const int to, Board &board) {
@@ -231,25 +368,14 @@ void MoveMaker::move_piece(const int from, const int to, Board &board) {
   assert(from >= 0 && from < 64);
   assert(to >= 0 && to < 64);
 
-  Piece side_pieces;
-
-  U64 bb = 1ULL << from;
-  int piece;
-  for (piece = 1; piece < 13; piece++) {
-    if (bb & board.pieces[piece]) {
-      if (piece <= 6) {
-        side_pieces = White_Pieces;
-      }
-      else {
-        side_pieces = Black_Pieces;
-      }
-      break;
-    }
-  }
+  int piece = board.piece_on[from];
+  assert(piece != None);
+
+  Piece side_pieces = (piece_color[piece] == White) ? White_Pieces : Black_Pieces;
 
-  assert(piece < 13);
   HASH_PCE(piece, from);
   HASH_PCE(piece, to);
+  board.pst_score += pst_value[piece][to] - pst_value[piece][from];
 
   U64 clear_mask = BitBoard::clear_mask[from];
   board.pieces[piece] &= clear_mask;
@@ -260,17 +386,16 @@ void MoveMaker::move_piece(const int from, const int to, Board &board) {
   board.pieces[piece] |= set_mask;
   board.pieces[side_pieces] |= set_mask;
   board.pieces[All_Pieces] |= set_mask;
+
+  board.piece_on[from] = None;
+  board.piece_on[to] = piece;
 }
 
-bool MoveMaker::move_exists(Board &board, const int move) {
+bool MoveMaker::move_exists(const Board &board, const int move) {
   Movelist list;
-  MoveGenerator::generate_moves(board, list);
+  MoveGenerator::generate_legal_moves(board, list);
 
   for (int move_num = 0; move_num < list.count; move_num++) {
-    if (!make_move(board, list.moves[move_num].move)) {
-      continue;
-    }
-    take_move(board);
     if (list.moves[move_num].move == move) {
       return true;
     }
@@ -5,10 +5,19 @@
 class MoveMaker {
 public:
   static void take_move(Board &board);
-  static bool make_move(Board &board, const int move);
-  static bool move_exists(Board &board, const int move);
+  static void make_move(Board &board, const int move);
+  static void make_null_move(Board &board);
+  static void take_null_move(Board &board);
+  static bool move_exists(const Board &board, const int move);
+  static bool copy_make;
 private:
+  static thread_local Position saved[MAX_GAME_MOVES];
   static void clear_piece(const int sq, Board &board);
   static void add_piece(const int sq, Board &board, const int piece);
   static void move_piece(const int from, const int to, Board &board);
+#ifdef ATTACK_MAPS
+  static U64 update_attacks(Board &board, const U64 changed);
+  static void rebuild_attacks(Board &board, const Color color);
+  static U64 changed_squares(const int move, const Color side);
+#endif
 };
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <algorithm>
 #include <cassert>
 
 #include "movegen.h"
@@ -22,8 +23,23 @@ static std::string move_type[4] = {
   "normal", "enpassant", "castle", "promotion"
 };
 
-static const int victim_score[13] = { 0, 100, 200, 300, 400, 500, 600, 100, 200, 300, 400, 500, 600 };
-static int mvv_lva_scores[13][13];
+// Piece values for exchange evaluation, the king outweighs anything it could win
+const int see_value[13] = { 0, 100, 325, 325, 550, 1000, 20000, 100, 325, 325, 550, 1000, 20000 };
+
+static constexpr int victim_score[13] = { 0, 100, 200, 300, 400, 500, 600, 100, 200, 300, 400, 500, 600 };
+
+// Most valuable victim first, the cheapest attacker breaking ties
+static constexpr std::array<std::array<int, 13>, 13> make_mvv_lva_scores() {
+  std::array<std::array<int, 13>, 13> scores{};
+  for (int attacker = White_Pawns; attacker <= Black_King; attacker++) {
+    for (int victim = White_Pawns; victim <= Black_King; victim++) {
+      scores[victim][attacker] = victim_score[victim] + 6 - (victim_score[attacker] / 100);
+    }
+  }
+  return scores;
+}
+
+static constexpr std::array<std::array<int, 13>, 13> mvv_lva_scores = make_mvv_lva_scores();
 
 Square int_to_square[64] = {
   A1, B1, C1, D1, E1, F1, G1, H1,
@@ -36,27 +52,6 @@ Square int_to_square[64] = {
   A8, B8, C8, D8, E8, F8, G8, H8
 };
 
-static const int LoopSlidePiece[8] = {
-  White_Bishops, White_Rooks, White_Queens, 0,
-  Black_Bishops, Black_Rooks, Black_Queens, 0
-};
-static const int LoopSlideIndex[2] = { 0, 4 };
-static const int LoopNonSlidePiece[6] = {
-  White_Knights, White_King, 0,
-  Black_Knights, Black_King, 0
-};
-static const int LoopNonSlideIndex[2] = { 0, 3 };
-static const int CaptureStartIndex[2] = { 7, 1 };
-static const int CaptureEndIndex[2] = { 13, 7 };
-
-void MoveGenerator::init() {
-  for (int attacker = White_Pawns; attacker <= Black_King; attacker++) {
-    for (int victim = White_Pawns; victim <= Black_King; victim++) {
-      mvv_lva_scores[victim][attacker] = victim_score[victim] + 6 - ( victim_score[attacker] / 100);
-    }
-  }
-}
-
 int MoveGenerator::parse_move(char *ch, Board &board) {
   if (ch[1] > '8' || ch[1] < '1') return NOMOVE;
   if (ch[3] > '8' || ch[3] < '1') return NOMOVE;
@@ -67,33 +62,12 @@ int MoveGenerator::parse_move(char *ch, Board &board) {
   int to = (ch[2] - 'a') + (8 * (ch[3] - '1'));
 
   Movelist list;
-  generate_moves(board, list);
+  generate_legal_moves(board, list);
   int move;
   for (int movenum = 0; movenum < list.count; movenum++) {
     move = list.moves[movenum].move;
     if (FROM_SQUARE(move) == from && TO_SQUARE(move) == to) {
-      int promoted_piece = PIECE_PROMOTED(move);
-      if (promoted_piece != None) {
-        switch(promoted_piece) {
-          case White_Queens:
-          case Black_Queens:
-            if (ch[4] == 'q') return move;
-            break;
-          case White_Rooks:
-          case Black_Rooks:
-            if (ch[4] == 'r') return move;
-            break;
-          case White_Bishops:
-          case Black_Bishops:
-            if (ch[4] == 'b') return move;
-            break;
-          case White_Knights:
-          case Black_Knights:
-            if (ch[4] == 'n') return move;
-            break;
-          default:
-            assert(false);
-        }
+      if (MOVE_TYPE(move) == Promotion && ch[4] != promotion_piece[PROMOTION_PIECE(move)][0]) {
         continue;
       }
 
@@ -104,669 +78,641 @@ int MoveGenerator::parse_move(char *ch, Board &board) {
   return NOMOVE;
 }
 
-std::string MoveGenerator::get_move(int &move) {
+std::string MoveGenerator::get_move(const int move) {
   std::string result = square_name[FROM_SQUARE(move)] + square_name[TO_SQUARE(move)];
 
-  int promoted = PIECE_PROMOTED(move);
-  if (promoted != 0) {
-    result += promotion_piece[(promoted % 6) - 2];
+  if (MOVE_TYPE(move) == Promotion) {
+    result += promotion_piece[PROMOTION_PIECE(move)];
   }
 
   //result += " " + move_type[MOVE_TYPE(move)];
   return result;
 }
 
-void MoveGenerator::generate_moves(const Board &board, Movelist &list) {
-  list.count = 0;
+void MoveGenerator::generate_legal_moves(const Board &board, Movelist &list) {
+  generate<AllMoves>(board, list);
+}
 
-  int from, to;
-  U64 piece;
-  U64 moves;
-  int cap_piece;
+// Captures and queen promotions
+void MoveGenerator::generate_legal_capture_moves(const Board &board, Movelist &list) {
+  generate<CaptureMoves>(board, list);
+}
 
-  int (*bit_scan) (U64);
+// The same with the checkers and pins the node already found
+void MoveGenerator::generate_legal_capture_moves(const Board &board, const CheckInfo &ci, Movelist &list) {
+  generate<CaptureMoves>(board, list, ci.checkers, ci.pinned);
+}
 
-  if (board.side == White) {
-    bit_scan = &BitBoard::bit_scan_forward;
+// Non-captures, including under-promotions and castling
+void MoveGenerator::generate_legal_quiet_moves(const Board &board, Movelist &list) {
+  generate<QuietMoves>(board, list);
+}
 
-    piece = board.pieces[White_Pawns];
-    while (piece) {
-      from = bit_scan(piece);
-      moves = pawn_quiet_moves(int_to_square[from], board.side, board.pieces[All_Pieces]);
+void MoveGenerator::generate_legal_quiet_moves(const Board &board, const CheckInfo &ci, Movelist &list) {
+  generate<QuietMoves>(board, list, ci.checkers, ci.pinned);
+}
 
-      while (moves) {
-        to = bit_scan(moves);
-        add_white_pawn_move(board, from, to, list);
-        moves &= BitBoard::clear_mask[to];
-      }
+// Finds the checkers and pinned pieces when the caller has none at hand
+template<GenType type>
+void MoveGenerator::generate(const Board &board, Movelist &list) {
+  Color opp = (board.side == White) ? Black : White;
+  int king_sq = BitBoard::bit_scan_forward(board.pieces[(board.side == White) ? White_King : Black_King]);
+  U64 side_pieces = board.pieces[(board.side == White) ? White_Pieces : Black_Pieces];
+  U64 opp_pieces = board.pieces[(board.side == White) ? Black_Pieces : White_Pieces];
+  U64 checkers = attackers_to(king_sq, board.pieces[All_Pieces], board) & opp_pieces;
 
-      moves = pawn_capture_moves(int_to_square[from], board.side,
-                                 board.pieces[White_Pieces], board.pieces[Black_Pieces]);
-      while (moves) {
-        to = bit_scan(moves);
-        for (cap_piece = 7; cap_piece < 13; cap_piece++) {
-          if (board.pieces[cap_piece] & (1ULL << to)) {
-            break;
-          }
-        }
-        add_white_pawn_capture_move(board, from, to, cap_piece, list);
-        moves &= BitBoard::clear_mask[to];
-      }
+  generate<type>(board, list, checkers, slider_blockers(board, king_sq, opp) & side_pieces);
+}
 
-      U64 enpassant = (board.enpassant == NOSQ) ? 0ULL : 1ULL << board.enpassant;
-      moves = pawn_capture_moves(int_to_square[from], board.side,
-                                 board.pieces[White_Pieces], enpassant);
-      while (moves) {
-        to = bit_scan(moves);
-        for (cap_piece = 7; cap_piece < 13; cap_piece++) {
-          if (board.pieces[cap_piece] & (1ULL << (to - 8))) {
-            break;
-          }
-        }
-        add_enpassant_move(board, MOVE(from, to, EnPassant, board.castle_perm, board.enpassant, cap_piece, None), list);
-        moves &= BitBoard::clear_mask[to];
-      }
+// Picks the instance for the side to move, all moves out of check come from
+// the Evasions instance
+template<GenType type>
+void MoveGenerator::generate(const Board &board, Movelist &list, const U64 checkers, const U64 pinned) {
+  list.count = 0;
 
-      piece &= BitBoard::clear_mask[from];
-    }
+  int king_sq = BitBoard::bit_scan_forward(board.pieces[(board.side == White) ? White_King : Black_King]);
 
-    if (board.castle_perm & WKCA) {
-      U64 f1g1 = (1ULL << F1) | (1ULL << G1);
-      if (!(board.pieces[All_Pieces] & f1g1)) {
-        if (!square_attacked(E1, Black, board) & !square_attacked(F1, Black, board)) {
-          add_quiet_move(board, MOVE(E1, G1, Castle, board.castle_perm, board.enpassant, None, None), list);
-        }
-      }
+  if (board.side == White) {
+    if (type == AllMoves && checkers) {
+      generate_moves<White, Evasions>(board, list, king_sq, checkers, pinned);
     }
-
-    if (board.castle_perm & WQCA) {
-      U64 b1c1d1 = (1ULL << B1) | (1ULL << C1) | (1ULL << D1);
-      if (!(board.pieces[All_Pieces] & b1c1d1)) {
-        if (!square_attacked(E1, Black, board) & !square_attacked(D1, Black, board)) {
-          add_quiet_move(board, MOVE(E1, C1, Castle, board.castle_perm, board.enpassant, None, None), list);
-        }
-      }
+    else {
+      generate_moves<White, type>(board, list, king_sq, checkers, pinned);
     }
-
   }
   else {
-    bit_scan = &BitBoard::bit_scan_reverse;
-    piece = board.pieces[Black_Pawns];
-    while (piece) {
-      from = bit_scan(piece);
-      moves = pawn_quiet_moves(int_to_square[from], board.side, board.pieces[All_Pieces]);
-
-      while (moves) {
-        to = bit_scan(moves);
-        add_black_pawn_move(board, from, to, list);
-        moves &= BitBoard::clear_mask[to];
-      }
+    if (type == AllMoves && checkers) {
+      generate_moves<Black, Evasions>(board, list, king_sq, checkers, pinned);
+    }
+    else {
+      generate_moves<Black, type>(board, list, king_sq, checkers, pinned);
+    }
+  }
+}
 
-      moves = pawn_capture_moves(int_to_square[from], board.side,
-                                 board.pieces[White_Pieces], board.pieces[Black_Pieces]);
-      while (moves) {
-        to = bit_scan(moves);
-        for (cap_piece = 1; cap_piece < 7; cap_piece++) {
-          if (board.pieces[cap_piece] & (1ULL << to)) {
-            break;
-          }
-        }
-        add_black_pawn_capture_move(board, from, to, cap_piece, list);
-        moves &= BitBoard::clear_mask[to];
-      }
+/*
+ * Only legal moves are generated. Pinned pieces come from the caller, a
+ * pinned piece may only move along the line through its king and when in check
+ * every non-king move has to capture the checker or block the check. Side and
+ * type are template arguments so the color and type tests fold away, AllMoves
+ * is only instantiated for positions without check.
+ */
+template<Color side, GenType type>
+void MoveGenerator::generate_moves(const Board &board, Movelist &list, const int king_sq, const U64 checkers,
+                                   const U64 pinned) {
+  const Color opp = (side == White) ? Black : White;
+  const int up = (side == White) ? 8 : -8;
 
-      U64 enpassant = (board.enpassant == NOSQ) ? 0ULL : 1ULL << board.enpassant;
-      moves = pawn_capture_moves(int_to_square[from], board.side,
-                                 enpassant, board.pieces[Black_Pieces]);
-      while (moves) {
-        to = bit_scan(moves);
-        for (cap_piece = 1; cap_piece < 7; cap_piece++) {
-          if (board.pieces[cap_piece] & (1ULL << (to + 8))) {
-            break;
-          }
-        }
-        add_enpassant_move(board, MOVE(from, to, EnPassant, board.castle_perm, board.enpassant, cap_piece, None), list);
-        moves &= BitBoard::clear_mask[to];
-      }
+  int from, to;
+  U64 piece;
+  U64 moves;
 
-      piece &= BitBoard::clear_mask[from];
+  U64 occupied = board.pieces[All_Pieces];
+  U64 side_pieces = board.pieces[(side == White) ? White_Pieces : Black_Pieces];
+  U64 opp_pieces = board.pieces[(side == White) ? Black_Pieces : White_Pieces];
+
+  U64 target = (type == CaptureMoves) ? opp_pieces : (type == QuietMoves) ? ~occupied : ~side_pieces;
+
+  // Squares the king may not step onto, the king is lifted off the board so
+  // sliders checking it also cover the squares behind it. Without a check the
+  // kept attack map is already exact.
+#ifdef ATTACK_MAPS
+  U64 danger = checkers ? attacks_by(board, opp, occupied ^ BitBoard::set_mask[king_sq]) : board.attacks[opp];
+#else
+  U64 danger = attacks_by(board, opp, occupied ^ BitBoard::set_mask[king_sq]);
+#endif
+  moves = BitBoard::king_moves[king_sq] & target & ~danger;
+  while (moves) {
+    to = BitBoard::pop_lsb(moves);
+    add_piece_move(board, king_sq, to, list);
+  }
+
+  // Squares a move out of a single check has to end on
+  U64 block = ~0ULL;
+  if (type != AllMoves && checkers) {
+    // Only the king can answer a double check
+    if (checkers & (checkers - 1)) {
+      return;
     }
+    block = BitBoard::between[king_sq][BitBoard::bit_scan_forward(checkers)] | checkers;
+    target &= block;
+  }
 
-    if (board.castle_perm & BKCA) {
-      U64 f8g8 = (1ULL << F8) | (1ULL << G8);
-      if (!(board.pieces[All_Pieces] & f8g8)) {
-        if (!square_attacked(E8, White, board) & !square_attacked(F8, White, board)) {
-          add_quiet_move(board, MOVE(E8, G8, Castle, board.castle_perm, board.enpassant, None, None), list);
-        }
-      }
-    }
+  // Pawns are moved as whole sets, only the destinations are walked. A pinned
+  // pawn shows up in the sets too and is filtered out in add_pawn_moves.
+  // Pushes to the last rank that promote to a queen go with the captures.
+  U64 pawns = board.pieces[(side == White) ? White_Pawns : Black_Pawns];
+  U64 empty = ~occupied;
+  U64 single = ((side == White) ? pawns << 8 : pawns >> 8) & empty;
 
-    if (board.castle_perm & BQCA) {
-      U64 b8c8d8 = (1ULL << B8) | (1ULL << C8) | (1ULL << D8);
-      if (!(board.pieces[All_Pieces] & b8c8d8)) {
-        if (!square_attacked(E8, White, board) & !square_attacked(D8, White, board)) {
-          add_quiet_move(board, MOVE(E8, C8, Castle, board.castle_perm, board.enpassant, None, None), list);
+  if (type != CaptureMoves) {
+    U64 start = single & BitBoard::rank[(side == White) ? Rank_3 : Rank_6];
+    U64 dbl = ((side == White) ? start << 8 : start >> 8) & empty & target;
+
+    add_pawn_moves(board, single & target, up, pinned, king_sq, false,
+                   (type == QuietMoves) ? UnderPromotions : AllPromotions, list);
+    add_pawn_moves(board, dbl, 2 * up, pinned, king_sq, false, AllPromotions, list);
+  }
+  else {
+    U64 last_rank = BitBoard::rank[(side == White) ? Rank_8 : Rank_1];
+    add_pawn_moves(board, single & last_rank & block, up, pinned, king_sq, true, QueenPromotions, list);
+  }
+
+  if (type != QuietMoves) {
+    U64 west = (side == White) ? BitBoard::noWeOne(pawns) : BitBoard::soWeOne(pawns);
+    U64 east = (side == White) ? BitBoard::noEaOne(pawns) : BitBoard::soEaOne(pawns);
+
+    add_pawn_moves(board, west & opp_pieces & target, up - 1, pinned, king_sq, true, AllPromotions, list);
+    add_pawn_moves(board, east & opp_pieces & target, up + 1, pinned, king_sq, true, AllPromotions, list);
+
+    // The pawns that could take en passant are the ones an enemy pawn on the
+    // target square would attack
+    if (board.enpassant != NOSQ) {
+      int cap_sq = board.enpassant - up;
+      piece = pawn_attacks(BitBoard::set_mask[board.enpassant], opp) & pawns;
+      while (piece) {
+        from = BitBoard::pop_lsb(piece);
+        if (king_safe_after(board, from, board.enpassant, cap_sq, king_sq)) {
+          add_enpassant_move(board, MOVE(from, board.enpassant, EnPassant, 0), list);
         }
       }
     }
   }
 
-  U64 side_pieces = (board.side == White) ? board.pieces[White_Pieces] : board.pieces[Black_Pieces];
-  U64 opp_pieces = (board.side == White) ? board.pieces[Black_Pieces] : board.pieces[White_Pieces];
-  int piece_type;
-
-  // Non-Sliding Pieces
-  int slide_idx = LoopNonSlideIndex[board.side];
-  while (piece_type = LoopNonSlidePiece[slide_idx++]) {
-    piece = board.pieces[piece_type];
-    while (piece) {
-      from = bit_scan(piece);
-      moves = get_nonslider_moves(piece_type, int_to_square[from], side_pieces);
-      while (moves) {
-        to = bit_scan(moves);
-        if ((1ULL << to) & opp_pieces) {
-          for (cap_piece = CaptureStartIndex[board.side]; cap_piece < CaptureEndIndex[board.side]; cap_piece++) {
-            if (board.pieces[cap_piece] & (1ULL << to)) {
-              break;
-            }
-          }
-          add_capture_move(board, MOVE(from, to, Normal, board.castle_perm, board.enpassant, cap_piece, None), list);
-        }
-        else {
-          add_quiet_move(board, MOVE(from, to, Normal, board.castle_perm, board.enpassant, None, None), list);
-        }
-        moves &= BitBoard::clear_mask[to];
-      }
-      piece &= BitBoard::clear_mask[from];
+  // A pinned knight can never move
+  piece = board.pieces[(side == White) ? White_Knights : Black_Knights] & ~pinned;
+  while (piece) {
+    from = BitBoard::pop_lsb(piece);
+    moves = BitBoard::knight_moves[from] & target;
+    while (moves) {
+      to = BitBoard::pop_lsb(moves);
+      add_piece_move(board, from, to, list);
     }
   }
 
-  // Sliding Pieces
-  slide_idx = LoopSlideIndex[board.side];
-  while (piece_type = LoopSlidePiece[slide_idx++]) {
-    piece = board.pieces[piece_type];
-    while (piece) {
-      from = bit_scan(piece);
-      moves = get_slider_moves(piece_type, int_to_square[from], board.pieces[All_Pieces], side_pieces);
-      while (moves) {
-        to = bit_scan(moves);
-        if ((1ULL << to) & opp_pieces) {
-          for (cap_piece = CaptureStartIndex[board.side]; cap_piece < CaptureEndIndex[board.side]; cap_piece++) {
-            if (board.pieces[cap_piece] & (1ULL << to)) {
-              break;
-            }
-          }
-          add_capture_move(board, MOVE(from, to, Normal, board.castle_perm, board.enpassant, cap_piece, None), list);
-        }
-        else {
-          add_quiet_move(board, MOVE(from, to, Normal, board.castle_perm, board.enpassant, None, None), list);
-        }
-        moves &= BitBoard::clear_mask[to];
-      }
-      piece &= BitBoard::clear_mask[from];
+  // Queens are walked once as a bishop and once as a rook
+  U64 queens = board.pieces[(side == White) ? White_Queens : Black_Queens];
+  piece = board.pieces[(side == White) ? White_Bishops : Black_Bishops] | queens;
+  while (piece) {
+    from = BitBoard::pop_lsb(piece);
+    moves = BitBoard::bishop_attacks(from, occupied) & target;
+    if (pinned & BitBoard::set_mask[from]) {
+      moves &= BitBoard::line[king_sq][from];
+    }
+    while (moves) {
+      to = BitBoard::pop_lsb(moves);
+      add_piece_move(board, from, to, list);
     }
   }
 
-}
-
-bool MoveGenerator::square_attacked(const Square &square, const Color &attacker_color, const Board &board) {
-  U64 bb_square = 1ULL << square;
+  piece = board.pieces[(side == White) ? White_Rooks : Black_Rooks] | queens;
+  while (piece) {
+    from = BitBoard::pop_lsb(piece);
+    moves = BitBoard::rook_attacks(from, occupied) & target;
+    if (pinned & BitBoard::set_mask[from]) {
+      moves &= BitBoard::line[king_sq][from];
+    }
+    while (moves) {
+      to = BitBoard::pop_lsb(moves);
+      add_piece_move(board, from, to, list);
+    }
+  }
 
-  U64 same_color = (attacker_color == White) ? board.pieces[White_Pieces] : board.pieces[Black_Pieces];
+  if (type == CaptureMoves || type == Evasions || checkers) {
+    return;
+  }
 
-  int start_index = (attacker_color == White) ? 1 : 7;
+  // The king may not pass through or land on an attacked square, the black
+  // squares are the white ones moved up seven ranks. Without a check no slider
+  // sees through the king square, so danger holds for these squares as well.
+  const int back_rank = (side == White) ? 0 : 56;
+  const int king_side = (side == White) ? WKCA : BKCA;
+  const int queen_side = (side == White) ? WQCA : BQCA;
 
-  U64 attacks =
-    pawn_attacks(board.pieces[start_index], attacker_color) |
-    knight_attacks(board.pieces[start_index + 1], same_color) |
-    bishop_attacks(board.pieces[start_index + 2], board.pieces[All_Pieces], same_color) |
-    rook_attacks(board.pieces[start_index + 3], board.pieces[All_Pieces], same_color) |
-    queen_attacks(board.pieces[start_index + 4], board.pieces[All_Pieces], same_color) |
-    king_attacks(board.pieces[start_index + 5], same_color);
+  if ((board.castle_perm & king_side) &&
+      !(occupied & (BitBoard::set_mask[F1 + back_rank] | BitBoard::set_mask[G1 + back_rank]))) {
+    if (!(danger & (BitBoard::set_mask[F1 + back_rank] | BitBoard::set_mask[G1 + back_rank]))) {
+      add_quiet_move(board, MOVE(E1 + back_rank, G1 + back_rank, Castle, 0), list);
+    }
+  }
 
-  return bb_square & attacks;
+  if ((board.castle_perm & queen_side) &&
+      !(occupied & (BitBoard::set_mask[B1 + back_rank] | BitBoard::set_mask[C1 + back_rank] |
+                    BitBoard::set_mask[D1 + back_rank]))) {
+    if (!(danger & (BitBoard::set_mask[D1 + back_rank] | BitBoard::set_mask[C1 + back_rank]))) {
+      add_quiet_move(board, MOVE(E1 + back_rank, C1 + back_rank, Castle, 0), list);
+    }
+  }
 }
 
-void MoveGenerator::add_quiet_move(const Board &board, int move, Movelist &list) {
-  list.moves[list.count].move = move;
+// Every piece of either color attacking sq given the occupancy
+U64 MoveGenerator::attackers_to(const int sq, const U64 &occupied, const Board &board) {
+  U64 bb = BitBoard::set_mask[sq];
+  U64 bishops_queens = board.pieces[White_Bishops] | board.pieces[Black_Bishops] |
+                       board.pieces[White_Queens] | board.pieces[Black_Queens];
+  U64 rooks_queens = board.pieces[White_Rooks] | board.pieces[Black_Rooks] |
+                     board.pieces[White_Queens] | board.pieces[Black_Queens];
+
+  return (pawn_attacks(bb, Black) & board.pieces[White_Pawns]) |
+         (pawn_attacks(bb, White) & board.pieces[Black_Pawns]) |
+         (BitBoard::knight_moves[sq] & (board.pieces[White_Knights] | board.pieces[Black_Knights])) |
+         (BitBoard::king_moves[sq] & (board.pieces[White_King] | board.pieces[Black_King])) |
+         (BitBoard::bishop_attacks(sq, occupied) & bishops_queens) |
+         (BitBoard::rook_attacks(sq, occupied) & rooks_queens);
+}
 
-  if (board.search_killers[0][board.ply] == move) {
-    list.moves[list.count].score = 900000;
-  }
-  else if (board.search_killers[1][board.ply] == move) {
-    list.moves[list.count].score = 800000;
-  }
-  else {
-    int from = FROM_SQUARE(move);
-    U64 from_bitboard = 1ULL << from;
-    int piece_type;
-    for (piece_type = White_Pawns; piece_type <= Black_King; piece_type++) {
-      if (board.pieces[piece_type] & from_bitboard) {
-        break; 
-      }
+// Pieces of either color that are the only blocker between the king on
+// king_sq and a slider of slider_color. Those of the king's own side are
+// pinned, those of the slider's side give discovered check when they move.
+U64 MoveGenerator::slider_blockers(const Board &board, const int king_sq, const Color slider_color) {
+  U64 result = 0ULL;
+  U64 occupied = board.pieces[All_Pieces];
+  int base = (slider_color == White) ? White_Pawns : Black_Pawns;
+  U64 queens = board.pieces[base + 4];
+  U64 snipers = (BitBoard::rook_attacks(king_sq, 0ULL) & (board.pieces[base + 3] | queens)) |
+                (BitBoard::bishop_attacks(king_sq, 0ULL) & (board.pieces[base + 2] | queens));
+
+  while (snipers) {
+    int sq = BitBoard::pop_lsb(snipers);
+    U64 blockers = BitBoard::between[king_sq][sq] & occupied;
+    if (blockers && !(blockers & (blockers - 1))) {
+      result |= blockers;
     }
-    assert(piece_type != 13);
-
-    list.moves[list.count].score = board.search_history[piece_type][TO_SQUARE(move)];
   }
 
-  list.count++;
+  return result;
 }
 
-void MoveGenerator::generate_capture_moves(const Board &board, Movelist &list) {
-  list.count = 0;
-
-  int from, to;
-  U64 piece;
-  U64 moves;
-  int cap_piece;
+// Whether the king on king_sq is still safe once the piece on from moves to to
+// and whatever stood on cap_sq is taken. En passant removes two pawns from the
+// same rank at once which can expose the king to a slider, so it is always
+// tested against the resulting occupancy.
+bool MoveGenerator::king_safe_after(const Board &board, const int from, const int to,
+                                    const int cap_sq, const int king_sq) {
+  U64 occupied = (board.pieces[All_Pieces] ^ BitBoard::set_mask[from] ^ BitBoard::set_mask[cap_sq]) |
+                 BitBoard::set_mask[to];
+  U64 opp_pieces = (board.side == White) ? board.pieces[Black_Pieces] : board.pieces[White_Pieces];
 
-  int (*bit_scan) (U64);
+  return !(attackers_to(king_sq, occupied, board) & opp_pieces & ~BitBoard::set_mask[cap_sq]);
+}
 
-  if (board.side == White) {
-    bit_scan = &BitBoard::bit_scan_forward;
-
-    piece = board.pieces[White_Pawns];
-    while (piece) {
-      from = bit_scan(piece);
-
-      moves = pawn_capture_moves(int_to_square[from], board.side,
-                                 board.pieces[White_Pieces], board.pieces[Black_Pieces]);
-      while (moves) {
-        to = bit_scan(moves);
-        for (cap_piece = 7; cap_piece < 13; cap_piece++) {
-          if (board.pieces[cap_piece] & (1ULL << to)) {
-            break;
-          }
-        }
-        add_white_pawn_capture_move(board, from, to, cap_piece, list);
-        moves &= BitBoard::clear_mask[to];
-      }
+bool MoveGenerator::square_attacked(const Square &square, const Color &attacker_color, const Board &board) {
+#ifdef ATTACK_MAPS
+  return board.attacks[attacker_color] & BitBoard::set_mask[square];
+#else
+  U64 attacker_pieces = board.pieces[(attacker_color == White) ? White_Pieces : Black_Pieces];
+  return attackers_to(square, board.pieces[All_Pieces], board) & attacker_pieces;
+#endif
+}
 
-      U64 enpassant = (board.enpassant == NOSQ) ? 0ULL : 1ULL << board.enpassant;
-      moves = pawn_capture_moves(int_to_square[from], board.side,
-                                 board.pieces[White_Pieces], enpassant);
-      while (moves) {
-        to = bit_scan(moves);
-        for (cap_piece = 7; cap_piece < 13; cap_piece++) {
-          if (board.pieces[cap_piece] & (1ULL << (to - 8))) {
-            break;
-          }
-        }
-        add_enpassant_move(board, MOVE(from, to, EnPassant, board.castle_perm, board.enpassant, cap_piece, None), list);
-        moves &= BitBoard::clear_mask[to];
-      }
+/*
+ * Whether move is one the generator could produce here if the safety of the
+ * king is ignored, checked against the board directly. Moves from the hash
+ * table or killer slots may come from another position and can hold anything.
+ */
+bool MoveGenerator::is_pseudo_legal(const Board &board, const int move) {
+  int from = FROM_SQUARE(move);
+  int to = TO_SQUARE(move);
+  int piece = board.piece_on[from];
+  Color side = board.side;
 
-      piece &= BitBoard::clear_mask[from];
-    }
+  if (move == NOMOVE || piece == None || piece_color[piece] != side) {
+    return false;
   }
-  else {
-    bit_scan = &BitBoard::bit_scan_reverse;
-    piece = board.pieces[Black_Pawns];
-    while (piece) {
-      from = bit_scan(piece);
-      moves = pawn_capture_moves(int_to_square[from], board.side,
-                                 board.pieces[White_Pieces], board.pieces[Black_Pieces]);
-      while (moves) {
-        to = bit_scan(moves);
-        for (cap_piece = 1; cap_piece < 7; cap_piece++) {
-          if (board.pieces[cap_piece] & (1ULL << to)) {
-            break;
-          }
-        }
-        add_black_pawn_capture_move(board, from, to, cap_piece, list);
-        moves &= BitBoard::clear_mask[to];
-      }
 
-      U64 enpassant = (board.enpassant == NOSQ) ? 0ULL : 1ULL << board.enpassant;
-      moves = pawn_capture_moves(int_to_square[from], board.side,
-                                 enpassant, board.pieces[Black_Pieces]);
-      while (moves) {
-        to = bit_scan(moves);
-        for (cap_piece = 1; cap_piece < 7; cap_piece++) {
-          if (board.pieces[cap_piece] & (1ULL << (to + 8))) {
-            break;
-          }
-        }
-        add_enpassant_move(board, MOVE(from, to, EnPassant, board.castle_perm, board.enpassant, cap_piece, None), list);
-        moves &= BitBoard::clear_mask[to];
-      }
+  // Only promotions carry a promotion piece
+  if (MOVE_TYPE(move) != Promotion && PROMOTION_PIECE(move) != 0) {
+    return false;
+  }
 
-      piece &= BitBoard::clear_mask[from];
-    }
+  U64 to_mask = BitBoard::set_mask[to];
+  U64 occupied = board.pieces[All_Pieces];
+  U64 opp_pieces = board.pieces[(side == White) ? Black_Pieces : White_Pieces];
+  if (board.pieces[(side == White) ? White_Pieces : Black_Pieces] & to_mask) {
+    return false;
   }
 
-  U64 side_pieces = (board.side == White) ? board.pieces[White_Pieces] : board.pieces[Black_Pieces];
-  U64 opp_pieces = (board.side == White) ? board.pieces[Black_Pieces] : board.pieces[White_Pieces];
-  int piece_type;
-
-  // Non-Sliding Pieces
-  int slide_idx = LoopNonSlideIndex[board.side];
-  while (piece_type = LoopNonSlidePiece[slide_idx++]) {
-    piece = board.pieces[piece_type];
-    while (piece) {
-      from = bit_scan(piece);
-      moves = get_nonslider_moves(piece_type, int_to_square[from], side_pieces);
-      while (moves) {
-        to = bit_scan(moves);
-        if ((1ULL << to) & opp_pieces) {
-          for (cap_piece = CaptureStartIndex[board.side]; cap_piece < CaptureEndIndex[board.side]; cap_piece++) {
-            if (board.pieces[cap_piece] & (1ULL << to)) {
-              break;
-            }
-          }
-          add_capture_move(board, MOVE(from, to, Normal, board.castle_perm, board.enpassant, cap_piece, None), list);
-        }
-        moves &= BitBoard::clear_mask[to];
-      }
-      piece &= BitBoard::clear_mask[from];
+  int pawn = (side == White) ? White_Pawns : Black_Pawns;
+  int up = (side == White) ? 8 : -8;
+
+  if (MOVE_TYPE(move) == Castle) {
+    int back_rank = (side == White) ? 0 : 56;
+    if (piece != pawn + 5 || from != E1 + back_rank) {
+      return false;
+    }
+    if (to == G1 + back_rank) {
+      return (board.castle_perm & ((side == White) ? WKCA : BKCA)) &&
+             !(occupied & (BitBoard::set_mask[F1 + back_rank] | to_mask));
     }
+    if (to == C1 + back_rank) {
+      return (board.castle_perm & ((side == White) ? WQCA : BQCA)) &&
+             !(occupied & (BitBoard::set_mask[B1 + back_rank] | to_mask | BitBoard::set_mask[D1 + back_rank]));
+    }
+    return false;
   }
 
-  // Sliding Pieces
-  slide_idx = LoopSlideIndex[board.side];
-  while (piece_type = LoopSlidePiece[slide_idx++]) {
-    piece = board.pieces[piece_type];
-    while (piece) {
-      from = bit_scan(piece);
-      moves = get_slider_moves(piece_type, int_to_square[from], board.pieces[All_Pieces], side_pieces);
-      while (moves) {
-        to = bit_scan(moves);
-        if ((1ULL << to) & opp_pieces) {
-          for (cap_piece = CaptureStartIndex[board.side]; cap_piece < CaptureEndIndex[board.side]; cap_piece++) {
-            if (board.pieces[cap_piece] & (1ULL << to)) {
-              break;
-            }
-          }
-          add_capture_move(board, MOVE(from, to, Normal, board.castle_perm, board.enpassant, cap_piece, None), list);
-        }
-        moves &= BitBoard::clear_mask[to];
-      }
-      piece &= BitBoard::clear_mask[from];
+  if (piece == pawn) {
+    U64 attacks = pawn_attacks(BitBoard::set_mask[from], side);
+
+    if (MOVE_TYPE(move) == EnPassant) {
+      return to == board.enpassant && (attacks & to_mask);
     }
-  }
-}
 
-void MoveGenerator::add_capture_move(const Board &board, int move, Movelist &list) {
-  list.moves[list.count].move = move;
+    // Reaching the last rank has to promote and nothing else may
+    bool last_rank = to_mask & (BitBoard::rank[Rank_1] | BitBoard::rank[Rank_8]);
+    if (last_rank != (MOVE_TYPE(move) == Promotion)) {
+      return false;
+    }
 
-  int from = FROM_SQUARE(move);
-  U64 from_bitboard = 1ULL << from;
-  int piece_type;
-  for (piece_type = White_Pawns; piece_type <= Black_King; piece_type++) {
-    if (board.pieces[piece_type] & from_bitboard) {
-      break; 
+    if (attacks & to_mask) {
+      return opp_pieces & to_mask;
     }
+    if (to == from + up) {
+      return !(occupied & to_mask);
+    }
+    if (to == from + 2 * up && from / 8 == ((side == White) ? Rank_2 : Rank_7)) {
+      return !(occupied & (BitBoard::set_mask[from + up] | to_mask));
+    }
+    return false;
   }
 
-  assert(piece_type != 13);
+  if (MOVE_TYPE(move) != Normal) {
+    return false;
+  }
 
-  list.moves[list.count].score = mvv_lva_scores[PIECE_CAPTURED(move)][piece_type] + 1000000;
-  list.count++;
-}
+  switch (piece - pawn) {
+    case 1: return BitBoard::knight_moves[from] & to_mask;
+    case 2: return BitBoard::bishop_attacks(from, occupied) & to_mask;
+    case 3: return BitBoard::rook_attacks(from, occupied) & to_mask;
+    case 4: return (BitBoard::bishop_attacks(from, occupied) | BitBoard::rook_attacks(from, occupied)) & to_mask;
+    case 5: return BitBoard::king_moves[from] & to_mask;
+  }
 
-void MoveGenerator::add_enpassant_move(const Board &board, int move, Movelist &list) {
-  list.moves[list.count].move = move;
-  list.moves[list.count].score = 105 + 1000000;
-  list.count++;
+  return false;
 }
 
-void MoveGenerator::add_white_pawn_capture_move(const Board &board, const int from, const int to, 
-                                                const int cap, Movelist &list) {
-  if (BitBoard::rank_sq[from] == Rank_7) {
-    add_capture_move(board, MOVE(from, to, 3, board.castle_perm, board.enpassant, cap, White_Queens), list);
-    add_capture_move(board, MOVE(from, to, 3, board.castle_perm, board.enpassant, cap, White_Rooks), list);
-    add_capture_move(board, MOVE(from, to, 3, board.castle_perm, board.enpassant, cap, White_Bishops), list);
-    add_capture_move(board, MOVE(from, to, 3, board.castle_perm, board.enpassant, cap, White_Knights), list);
-  }
-  else {
-    add_capture_move(board, MOVE(from, to, 0, board.castle_perm, board.enpassant, cap, None), list);
-  }
-}
+// The legality test for a move is_pseudo_legal accepted, far cheaper than
+// generating the legal moves and looking for it
+bool MoveGenerator::is_legal(const Board &board, const int move) {
+  int from = FROM_SQUARE(move);
+  int to = TO_SQUARE(move);
+  Color side = board.side;
+  U64 occupied = board.pieces[All_Pieces];
+  U64 opp_pieces = board.pieces[(side == White) ? Black_Pieces : White_Pieces];
+  int king_sq = BitBoard::bit_scan_forward(board.pieces[(side == White) ? White_King : Black_King]);
 
-void MoveGenerator::add_white_pawn_move(const Board &board, const int from, const int to, Movelist &list) {
- if (BitBoard::rank_sq[from] == Rank_7) {
-    add_quiet_move(board, MOVE(from, to, 3, board.castle_perm, board.enpassant, None, White_Queens), list);
-    add_quiet_move(board, MOVE(from, to, 3, board.castle_perm, board.enpassant, None, White_Rooks), list);
-    add_quiet_move(board, MOVE(from, to, 3, board.castle_perm, board.enpassant, None, White_Bishops), list);
-    add_quiet_move(board, MOVE(from, to, 3, board.castle_perm, board.enpassant, None, White_Knights), list);
+  if (MOVE_TYPE(move) == Castle) {
+    int step = (to > from) ? 1 : -1;
+    return !(attackers_to(from, occupied, board) & opp_pieces) &&
+           !(attackers_to(from + step, occupied, board) & opp_pieces) &&
+           !(attackers_to(to, occupied, board) & opp_pieces);
   }
-  else {
-    add_quiet_move(board, MOVE(from, to, 0, board.castle_perm, board.enpassant, None, None), list);
-  }
-}
 
-void MoveGenerator::add_black_pawn_capture_move(const Board &board, const int from, const int to, const int cap, Movelist &list) {
-  if (BitBoard::rank_sq[from] == Rank_2) {
-    add_capture_move(board, MOVE(from, to, 3, board.castle_perm, board.enpassant, cap, Black_Queens), list);
-    add_capture_move(board, MOVE(from, to, 3, board.castle_perm, board.enpassant, cap, Black_Rooks), list);
-    add_capture_move(board, MOVE(from, to, 3, board.castle_perm, board.enpassant, cap, Black_Bishops), list);
-    add_capture_move(board, MOVE(from, to, 3, board.castle_perm, board.enpassant, cap, Black_Knights), list);
+  if (from == king_sq) {
+    return !(attackers_to(to, occupied ^ BitBoard::set_mask[from], board) & opp_pieces);
   }
-  else {
-    add_capture_move(board, MOVE(from, to, 0, board.castle_perm, board.enpassant, cap, None), list);
-  }
-}
 
-void MoveGenerator::add_black_pawn_move(const Board &board, const int from, const int to, Movelist &list) {
-  if (BitBoard::rank_sq[from] == Rank_2) {
-    add_quiet_move(board, MOVE(from, to, 3, board.castle_perm, board.enpassant, None, Black_Queens), list);
-    add_quiet_move(board, MOVE(from, to, 3, board.castle_perm, board.enpassant, None, Black_Rooks), list);
-    add_quiet_move(board, MOVE(from, to, 3, board.castle_perm, board.enpassant, None, Black_Bishops), list);
-    add_quiet_move(board, MOVE(from, to, 3, board.castle_perm, board.enpassant, None, Black_Knights), list);
-  }
-  else {
-    add_quiet_move(board, MOVE(from, to, 0, board.castle_perm, board.enpassant, None, None), list);
+  int cap_sq = to;
+  if (MOVE_TYPE(move) == EnPassant) {
+    cap_sq = (side == White) ? to - 8 : to + 8;
   }
+
+  return king_safe_after(board, from, to, cap_sq, king_sq);
 }
 
-static const U64 FILE_SQ[64] = {
-  0, 1, 2, 3, 4, 5, 6, 7,
-  0, 1, 2, 3, 4, 5, 6, 7,
-  0, 1, 2, 3, 4, 5, 6, 7,
-  0, 1, 2, 3, 4, 5, 6, 7,
-  0, 1, 2, 3, 4, 5, 6, 7,
-  0, 1, 2, 3, 4, 5, 6, 7,
-  0, 1, 2, 3, 4, 5, 6, 7,
-  0, 1, 2, 3, 4, 5, 6, 7
-};
+/*
+ * Static exchange evaluation, the material the side to move ends up with after
+ * move and the best sequence of recaptures on its target square, each side
+ * taking with its least valuable attacker and free to stop when that pays.
+ * Sliders lined up behind a piece that has captured join in as x-rays.
+ */
+int MoveGenerator::see(const Board &board, const int move) {
+  int from = FROM_SQUARE(move);
+  int to = TO_SQUARE(move);
 
-static const U64 RANK_SQ[64] = {
-  0, 0, 0, 0, 0, 0, 0, 0,
-  1, 1, 1, 1, 1, 1, 1, 1,
-  2, 2, 2, 2, 2, 2, 2, 2,
-  3, 3, 3, 3, 3, 3, 3, 3,
-  4, 4, 4, 4, 4, 4, 4, 4,
-  5, 5, 5, 5, 5, 5, 5, 5,
-  6, 6, 6, 6, 6, 6, 6, 6,
-  7, 7, 7, 7, 7, 7, 7, 7
-};
+  if (MOVE_TYPE(move) == Castle) {
+    return 0;
+  }
 
-U64 MoveGenerator::pawn_capture_moves(const Square &sq, const Color &color,
-                                 const U64 &white_pieces, const U64 &black_pieces) {
-  U64 result = 0ULL;
-  U64 pos = BitBoard::set_mask[sq];
-  if (color == White) {
-    U64 cap_sq = black_pieces;
-    if (!(FILE_SQ[sq] == File_A) && ((pos << 7) & cap_sq)) {
-      result |= pos << 7;
-    }
-    if (!(FILE_SQ[sq] == File_H) && ((pos << 9) & cap_sq)) {
-      result |= pos << 9;
-    }
+  int gain[32];
+  int depth = 0;
+  int attacker = board.piece_on[from];
+  U64 occupied = board.pieces[All_Pieces];
+  U64 from_set = BitBoard::set_mask[from];
+
+  gain[0] = see_value[board.piece_on[to]];
+  if (MOVE_TYPE(move) == EnPassant) {
+    gain[0] = see_value[White_Pawns];
+    occupied ^= BitBoard::set_mask[(board.side == White) ? to - 8 : to + 8];
   }
-  else {
-    U64 cap_sq = white_pieces;
-    if (!(FILE_SQ[sq] == File_A) && ((pos >> 9) & cap_sq)) {
-      result |= pos >> 9;
-    }
-    if (!(FILE_SQ[sq] == File_H) && ((pos >> 7) & cap_sq)) {
-      result |= pos >> 7;
-    }
+  else if (MOVE_TYPE(move) == Promotion) {
+    attacker += 1 + PROMOTION_PIECE(move);
+    gain[0] += see_value[attacker] - see_value[White_Pawns];
   }
 
-  return result;
-}
+  U64 bishops_queens = board.pieces[White_Bishops] | board.pieces[Black_Bishops] |
+                       board.pieces[White_Queens] | board.pieces[Black_Queens];
+  U64 rooks_queens = board.pieces[White_Rooks] | board.pieces[Black_Rooks] |
+                     board.pieces[White_Queens] | board.pieces[Black_Queens];
+  U64 attackers = attackers_to(to, occupied, board);
+  Color side = board.side;
 
-U64 MoveGenerator::pawn_quiet_moves(const Square &sq, const Color &color, const U64 &occupied) {
-  U64 result = 0ULL;
-  U64 pos = BitBoard::set_mask[sq];
-  if (color == White) {
-    if (!((pos << 8) & occupied)) {
-      result |= pos << 8;
-      if (RANK_SQ[sq] == Rank_2 && !((pos << 16) & occupied)) {
-        result |= pos << 16;
-      }
+  do {
+    depth++;
+    gain[depth] = see_value[attacker] - gain[depth - 1];
+
+    // Neither side can come out ahead of what is already settled
+    if (std::max(-gain[depth - 1], gain[depth]) < 0) {
+      break;
     }
-  }
-  else {
-    if (!((pos >> 8) & occupied)) {
-      result |= pos >> 8;
-      if (RANK_SQ[sq] == Rank_7 && !((pos >> 16) & occupied)) {
-        result |= pos >> 16;
+
+    occupied ^= from_set;
+    attackers |= (BitBoard::bishop_attacks(to, occupied) & bishops_queens) |
+                 (BitBoard::rook_attacks(to, occupied) & rooks_queens);
+    attackers &= occupied;
+
+    side = (side == White) ? Black : White;
+    from_set = 0ULL;
+    int first = (side == White) ? White_Pawns : Black_Pawns;
+    for (int piece = first; piece <= first + 5; piece++) {
+      U64 candidates = attackers & board.pieces[piece];
+      if (candidates) {
+        from_set = candidates & -candidates;
+        attacker = piece;
+        break;
       }
     }
+  } while (from_set && depth < 31);
+
+  while (--depth) {
+    gain[depth - 1] = -std::max(-gain[depth - 1], gain[depth]);
   }
 
-  return result;
+  return gain[0];
 }
 
-U64 MoveGenerator::knight_moves(const Square &sq, const U64 &same_color) {
-  return BitBoard::knight_moves[sq] & ~same_color;
+// Fills ci for the side to move, once per node, so gives_check and the move
+// generator need no attack computation of their own. The search already knows
+// whether the side is in check, the checkers are only looked for if it is.
+void MoveGenerator::check_info(const Board &board, const bool in_check, CheckInfo &ci) {
+  Color side = board.side;
+  Color opp = (side == White) ? Black : White;
+  U64 occupied = board.pieces[All_Pieces];
+  U64 side_pieces = board.pieces[(side == White) ? White_Pieces : Black_Pieces];
+  U64 opp_pieces = board.pieces[(side == White) ? Black_Pieces : White_Pieces];
+  int king_sq = BitBoard::bit_scan_forward(board.pieces[(side == White) ? White_King : Black_King]);
+
+  ci.king_sq = BitBoard::bit_scan_forward(board.pieces[(side == White) ? Black_King : White_King]);
+  ci.checkers = in_check ? attackers_to(king_sq, occupied, board) & opp_pieces : 0ULL;
+  ci.pinned = slider_blockers(board, king_sq, opp) & side_pieces;
+  ci.discover = slider_blockers(board, ci.king_sq, side) & side_pieces;
+
+  // Indexed like the pieces of one color, Pawns = 1 up to King = 6
+  ci.check_squares[0] = 0ULL;
+  ci.check_squares[1] = pawn_attacks(BitBoard::set_mask[ci.king_sq], opp);
+  ci.check_squares[2] = BitBoard::knight_moves[ci.king_sq];
+  ci.check_squares[3] = BitBoard::bishop_attacks(ci.king_sq, occupied);
+  ci.check_squares[4] = BitBoard::rook_attacks(ci.king_sq, occupied);
+  ci.check_squares[5] = ci.check_squares[3] | ci.check_squares[4];
+  ci.check_squares[6] = 0ULL;
 }
 
-U64 MoveGenerator::bishop_moves(const Square &sq, const U64 &occupied, const U64 &same_color) {
-  U64 result = 0ULL;
-
-  U64 ray = 0ULL;
-  U64 intersect = 0ULL;
-  U64 beyond_blocker = 0ULL;
-
-  Direction dirs[4] = {NorthWest, NorthEast, SouthWest, SouthEast};
-  bool reverse[4] = {false, false, true, true};
+// Whether a legal move checks the enemy king, asked before the move is made
+bool MoveGenerator::gives_check(const Board &board, const CheckInfo &ci, const int move) {
+  int from = FROM_SQUARE(move);
+  int to = TO_SQUARE(move);
+  int base = (board.side == White) ? White_Pawns : Black_Pawns;
+  int type = board.piece_on[from] - base + 1;
+  U64 king_mask = BitBoard::set_mask[ci.king_sq];
 
-  for (int i = 0; i < 4; i++) {
-    ray = BitBoard::ray_attacks[sq][dirs[i]];
-    intersect = ray & occupied;
-    if (intersect) {
-      if (reverse[i]) {
-        beyond_blocker = BitBoard::ray_attacks[BitBoard::bit_scan_reverse(intersect)][dirs[i]];
-      }
-      else {
-        beyond_blocker = BitBoard::ray_attacks[BitBoard::bit_scan_forward(intersect)][dirs[i]];
-      }
-    }
-    result |= beyond_blocker ^ ray;
-    beyond_blocker = 0ULL;
+  // Direct check, a promotion checks with the piece it becomes
+  if (MOVE_TYPE(move) != Promotion && (ci.check_squares[type] & BitBoard::set_mask[to])) {
+    return true;
   }
 
-  return result & ~same_color;
-}
+  // Discovered check, the piece steps off the line to the enemy king
+  if ((ci.discover & BitBoard::set_mask[from]) && !(BitBoard::line[ci.king_sq][from] & BitBoard::set_mask[to])) {
+    return true;
+  }
 
-U64 MoveGenerator::rook_moves(const Square &sq, const U64 &occupied, const U64 &same_color) {
-  U64 result = 0ULL;
+  U64 occupied = board.pieces[All_Pieces] ^ BitBoard::set_mask[from];
 
-  U64 ray = 0ULL;
-  U64 intersect = 0ULL;
-  U64 beyond_blocker = 0ULL;
+  switch (MOVE_TYPE(move)) {
+    case Promotion:
+      switch (1 + PROMOTION_PIECE(move)) {
+        case 1: return BitBoard::knight_moves[to] & king_mask;
+        case 2: return BitBoard::bishop_attacks(to, occupied) & king_mask;
+        case 3: return BitBoard::rook_attacks(to, occupied) & king_mask;
+        default: return (BitBoard::bishop_attacks(to, occupied) | BitBoard::rook_attacks(to, occupied)) & king_mask;
+      }
 
-  Direction dirs[4] = {North, East, South, West};
-  bool reverse[4] = {false, false, true, true};
+    // The captured pawn leaving can open a line the moving pawn did not
+    case EnPassant: {
+      int cap_sq = (board.side == White) ? to - 8 : to + 8;
+      occupied = (occupied ^ BitBoard::set_mask[cap_sq]) | BitBoard::set_mask[to];
+      U64 queens = board.pieces[base + 4];
+      return (BitBoard::bishop_attacks(ci.king_sq, occupied) & (board.pieces[base + 2] | queens)) |
+             (BitBoard::rook_attacks(ci.king_sq, occupied) & (board.pieces[base + 3] | queens));
+    }
 
-  for (int i = 0; i < 4; i++) {
-    ray = BitBoard::ray_attacks[sq][dirs[i]];
-    intersect = ray & occupied;
-    if (intersect) {
-      if (reverse[i]) {
-        beyond_blocker = BitBoard::ray_attacks[BitBoard::bit_scan_reverse(intersect)][dirs[i]];
-      }
-      else {
-        beyond_blocker = BitBoard::ray_attacks[BitBoard::bit_scan_forward(intersect)][dirs[i]];
-      }
+    // Only the rook can check, from the square next to the king's origin
+    case Castle: {
+      int rook_from = (to > from) ? from + 3 : from - 4;
+      int rook_to = (to > from) ? from + 1 : from - 1;
+      occupied = (occupied ^ BitBoard::set_mask[rook_from]) | BitBoard::set_mask[to] | BitBoard::set_mask[rook_to];
+      return BitBoard::rook_attacks(rook_to, occupied) & king_mask;
     }
-    result |= beyond_blocker ^ ray;
-    beyond_blocker = 0ULL;
   }
 
-  return result & ~same_color;
+  return false;
 }
 
-U64 MoveGenerator::queen_moves(const Square &sq, const U64 &occupied, const U64 &same_color) {
-  return rook_moves(sq, occupied, same_color) | bishop_moves(sq, occupied, same_color);
-}
+// Every square attacked by color given the occupancy, built set-wise
+U64 MoveGenerator::attacks_by(const Board &board, const Color color, const U64 &occupied) {
+  int base = (color == White) ? White_Pawns : Black_Pawns;
+  U64 queens = board.pieces[base + 4];
 
-U64 MoveGenerator::king_moves(const Square &sq, const U64 &same_color) {
-  return BitBoard::king_moves[sq] & ~same_color;
+  return pawn_attacks(board.pieces[base], color) |
+         BitBoard::knight_attacks(board.pieces[base + 1]) |
+         BitBoard::slider_attacks(board.pieces[base + 3] | queens, board.pieces[base + 2] | queens, occupied) |
+         BitBoard::king_moves[BitBoard::bit_scan_forward(board.pieces[base + 5])];
 }
 
-U64 MoveGenerator::get_nonslider_moves(const int &piece_type, const Square &sq, const U64 &same_color) {
-  switch(piece_type % 6) {
-    case 2: return knight_moves(sq, same_color);
-    case 0: return king_moves(sq, same_color);
-    default: assert(false);
-  }
-}
+void MoveGenerator::add_quiet_move(const Board &board, int move, Movelist &list) {
+  assert(list.count < MAX_POSITION_MOVES);
 
-U64 MoveGenerator::get_slider_moves(const int &piece_type, const Square &sq, const U64 &occupied, 
-                                    const U64 &same_color) {
-  switch (piece_type % 6) {
-    case 3: return bishop_moves(sq, occupied, same_color);
-    case 4: return rook_moves(sq, occupied, same_color);
-    case 5: return queen_moves(sq, occupied, same_color);
-    default: assert(false);
-  }
+  // Scored by the move picker, the history lives with the search
+  list.moves[list.count].move = move;
+  list.moves[list.count].score = 0;
+  list.count++;
 }
 
-U64 MoveGenerator::pawn_attacks(U64 pawns, Color color) {
-  if (color == White) {
-    return BitBoard::noEaOne(pawns) | BitBoard::noWeOne(pawns);
-  }
-  return BitBoard::soEaOne(pawns) | BitBoard::soWeOne(pawns);
-}
+void MoveGenerator::add_capture_move(const Board &board, int move, Movelist &list) {
+  assert(list.count < MAX_POSITION_MOVES);
 
-U64 MoveGenerator::knight_attacks(U64 knights, U64 same_color) {
-  U64 result = 0ULL;
-  while (knights) {
-    int sq = BitBoard::bit_scan_forward(knights);
-    result |= knight_moves(int_to_square[sq], same_color);
-    knights &= knights - 1;
+  list.moves[list.count].move = move;
+
+  int piece_type = board.piece_on[FROM_SQUARE(move)];
+  assert(piece_type != None);
+
+  list.moves[list.count].score = mvv_lva_scores[board.piece_on[TO_SQUARE(move)]][piece_type];
+  if (MOVE_TYPE(move) == Promotion && PROMOTION_PIECE(move) == PromoteQueen) {
+    list.moves[list.count].score += victim_score[White_Queens];
   }
-  return result;  
+  list.count++;
 }
 
-U64 MoveGenerator::bishop_attacks(U64 bishops, U64 occupied, U64 same_color) {
-  U64 result = 0ULL;
-  while (bishops) {
-    int sq = BitBoard::bit_scan_forward(bishops);
-    result |= bishop_moves(int_to_square[sq], occupied, same_color);
-    bishops &= bishops - 1;
-  }
-  return result;  
+void MoveGenerator::add_enpassant_move(const Board &board, int move, Movelist &list) {
+  assert(list.count < MAX_POSITION_MOVES);
+
+  list.moves[list.count].move = move;
+  list.moves[list.count].score = 105;
+  list.count++;
 }
 
-U64 MoveGenerator::rook_attacks(U64 rooks, U64 occupied, U64 same_color) {
-  U64 result = 0ULL;
-  while (rooks) {
-    int sq = BitBoard::bit_scan_forward(rooks);
-    result |= rook_moves(int_to_square[sq], occupied, same_color);
-    rooks &= rooks - 1;
+void MoveGenerator::add_piece_move(const Board &board, const int from, const int to, Movelist &list) {
+  if (board.piece_on[to] != None) {
+    add_capture_move(board, MOVE(from, to, Normal, 0), list);
+  }
+  else {
+    add_quiet_move(board, MOVE(from, to, Normal, 0), list);
   }
-  return result; 
 }
 
-U64 MoveGenerator::queen_attacks(U64 queens, U64 occupied, U64 same_color) {
-  U64 result = 0ULL;
-  while (queens) {
-    int sq = BitBoard::bit_scan_forward(queens);
-    result |= queen_moves(int_to_square[sq], occupied, same_color);
-    queens &= queens - 1;
+// Every square in moves was reached by a pawn standing shift squares back. A
+// pinned pawn keeps only the moves along the line through its king. Moves
+// scored as captures go through add_capture_move, so do quiet queen promotions.
+void MoveGenerator::add_pawn_moves(const Board &board, U64 moves, const int shift, const U64 pinned,
+                                   const int king_sq, const bool capture, const PromotionSet promotions,
+                                   Movelist &list) {
+  int from, to;
+  while (moves) {
+    to = BitBoard::pop_lsb(moves);
+    from = to - shift;
+
+    if ((pinned & BitBoard::set_mask[from]) && !(BitBoard::line[king_sq][from] & BitBoard::set_mask[to])) {
+      continue;
+    }
+
+    // Promotions are listed queen first
+    bool promotion = BitBoard::set_mask[to] & (BitBoard::rank[Rank_1] | BitBoard::rank[Rank_8]);
+    int first = (promotion && promotions == UnderPromotions) ? 1 : 0;
+    int count = !promotion ? 1 : (promotions == QueenPromotions) ? 1 : 4;
+    for (int i = first; i < count; i++) {
+      int move = !promotion ? MOVE(from, to, Normal, 0) : MOVE(from, to, Promotion, PromoteQueen - i);
+      if (capture) {
+        add_capture_move(board, move, list);
+      }
+      else {
+        add_quiet_move(board, move, list);
+      }
+    }
   }
-  return result; 
 }
 
-U64 MoveGenerator::king_attacks(U64 king, U64 same_color) {
-  int sq = BitBoard::bit_scan_forward(king);
-  return king_moves(int_to_square[sq], same_color);
+U64 MoveGenerator::pawn_attacks(U64 pawns, Color color) {
+  if (color == White) {
+    return BitBoard::noEaOne(pawns) | BitBoard::noWeOne(pawns);
+  }
+  return BitBoard::soEaOne(pawns) | BitBoard::soWeOne(pawns);
 }
-
-
@@ -3,82 +3,127 @@
 #include "board.h"
 
 #define NOMOVE 0
+#define MAX_POSITION_MOVES 256
 
 enum MoveType {
   Normal, EnPassant, Castle, Promotion
 };
 
+enum GenType {
+  AllMoves, CaptureMoves, QuietMoves, Evasions
+};
+
+enum PromotionPiece {
+  PromoteKnight, PromoteBishop, PromoteRook, PromoteQueen
+};
+
+// Which promotions of a pawn move add_pawn_moves lists
+enum PromotionSet {
+  AllPromotions, QueenPromotions, UnderPromotions
+};
+
 /*
  * Move Representation
- * <-------------- 32-bits -------------->
- * 0000 0000 0000 0000 0000 0000 0011 1111 Source Square
- * 0000 0000 0000 0000 0000 1111 1100 0000 Destination Square
- * 0000 0000 0000 0000 0011 0000 0000 0000 Type (Normal, EnPassant, Castle, Promotion)
- * 0000 0000 0000 0011 1100 0000 0000 0000 Castle Permissions (before move was played)
- * 0000 0000 1111 1100 0000 0000 0000 0000 EnPassant Sqaure (before move was played)
- * 0000 1111 0000 0000 0000 0000 0000 0000 Piece Captured on Move
- * 1111 0000 0000 0000 0000 0000 0000 0000 Piece Promoted to on Move
+ * <------ 16-bits ------>
+ * 0000 0000 0011 1111 Source Square
+ * 0000 1111 1100 0000 Destination Square
+ * 0011 0000 0000 0000 Type (Normal, EnPassant, Castle, Promotion)
+ * 1100 0000 0000 0000 Promotion Piece (Knight, Bishop, Rook, Queen)
+ *
+ * The captured piece, castle permissions and enpassant square are not part of
+ * the move, make_move saves them in the board's Undo history instead.
  */
-#define FROM_SQUARE(x) (x & 0x3F)
-#define TO_SQUARE(x) ((x >> 6) & 0x3F)
-#define MOVE_TYPE(x) ((x >> 12) & 0x3)
-#define CASTLE_PERMISSION(x) ((x >> 14) & 0xF)
-#define ENPASSANT_SQUARE(x) ((x >> 18) & 0x3F)
-#define PIECE_CAPTURED(x) ((x >> 24) & 0xF)
-#define PIECE_PROMOTED(x) ((x >> 28) & 0xF)
+#define FROM_SQUARE(x) ((x) & 0x3F)
+#define TO_SQUARE(x) (((x) >> 6) & 0x3F)
+#define MOVE_TYPE(x) (((x) >> 12) & 0x3)
+#define PROMOTION_PIECE(x) (((x) >> 14) & 0x3)
 
-#define MOVE(f, t, mt, cp, es, pc, pp) \
-  ((f) | (t<<6) | (mt<<12) | (cp<<14) | ((es & 0x3F)<<18) | (pc<<24) | (pp<<28))
+#define MOVE(f, t, mt, pp) ((f) | ((t) << 6) | ((mt) << 12) | ((pp) << 14))
 
+// History scores are clamped to fit the 16-bit score of a Move
+#define MAX_HISTORY_SCORE 30000
 
 typedef struct {
-  int move;
-  int score;
+  unsigned short move;
+  short score;
 } Move;
 
+// No legal position has more than 218 moves
 typedef struct {
-  Move moves[MAX_GAME_MOVES];
+  Move moves[MAX_POSITION_MOVES];
   int count;
 } Movelist;
 
+// What the side to move needs to know about checks in a position, found once
+// per node
+typedef struct {
+  U64 checkers;            // enemy pieces checking our king
+  U64 pinned;              // our pieces pinned to our king
+  U64 discover;            // our pieces whose move can uncover a check
+  U64 check_squares[7];    // where each of our piece types would check, by type
+  int king_sq;             // the enemy king
+} CheckInfo;
+
 class MoveGenerator {
 public:
-  static void init();
   static int parse_move(char *ch, Board &board);
-  static void generate_moves(const Board &board, Movelist &list);
-  static void generate_capture_moves(const Board &board, Movelist &list);
-  static std::string get_move(int &move);
+  static void generate_legal_moves(const Board &board, Movelist &list);
+  static void generate_legal_capture_moves(const Board &board, Movelist &list);
+  static void generate_legal_capture_moves(const Board &board, const CheckInfo &ci, Movelist &list);
+  static void generate_legal_quiet_moves(const Board &board, Movelist &list);
+  static void generate_legal_quiet_moves(const Board &board, const CheckInfo &ci, Movelist &list);
+  static std::string get_move(const int move);
+  static bool is_capture(const Board &board, const int move);
+  static bool is_tactical(const Board &board, const int move);
+  static int captured_piece(const Board &board, const int move);
+  static bool is_pseudo_legal(const Board &board, const int move);
+  static bool is_legal(const Board &board, const int move);
+  static int see(const Board &board, const int move);
+  static void check_info(const Board &board, const bool in_check, CheckInfo &ci);
+  static bool gives_check(const Board &board, const CheckInfo &ci, const int move);
   static bool square_attacked(const Square &square, const Color &attacker_color,
                               const Board &board);
+  static U64 attackers_to(const int sq, const U64 &occupied, const Board &board);
+  static U64 attacks_by(const Board &board, const Color color, const U64 &occupied);
+private:
+  template<GenType type>
+  static void generate(const Board &board, Movelist &list);
+  template<GenType type>
+  static void generate(const Board &board, Movelist &list, const U64 checkers, const U64 pinned);
+  template<Color side, GenType type>
+  static void generate_moves(const Board &board, Movelist &list, const int king_sq, const U64 checkers,
+                             const U64 pinned);
+  static U64 slider_blockers(const Board &board, const int king_sq, const Color slider_color);
+  static bool king_safe_after(const Board &board, const int from, const int to,
+                              const int cap_sq, const int king_sq);
 private:
   static void add_quiet_move(const Board &board, int move, Movelist &list);
   static void add_capture_move(const Board &board, int move, Movelist &list);
   static void add_enpassant_move(const Board &board, int move, Movelist &list);
-  static void add_white_pawn_capture_move(const Board &board, const int from, const int to, 
-                                          const int cap, Movelist &list);
-  static void add_white_pawn_move(const Board &board, const int from, const int to, Movelist &list);
-  static void add_black_pawn_capture_move(const Board &board, const int from, const int to, 
-                                          const int cap, Movelist &list);
-  static void add_black_pawn_move(const Board &board, const int from, const int to, Movelist &list);
-private:
-  static U64 pawn_capture_moves(const Square &sq, const Color &color,
-                                const U64 &white_pieces, const U64 &black_pieces);
-  static U64 pawn_quiet_moves(const Square &sq, const Color &c, const U64 &occupied);
-  static U64 knight_moves(const Square &sq, const U64 &same_color);
-  static U64 bishop_moves(const Square &sq, const U64 &occupied, const U64 &same_color);
-  static U64 rook_moves(const Square &sq, const U64 &occupied, const U64 &same_color);
-  static U64 queen_moves(const Square &sq, const U64 &occupied, const U64 &same_color);
-  static U64 king_moves(const Square &sq, const U64 &same_color);
-  static U64 get_nonslider_moves(const int &piece_type, const Square &sq, const U64 &same_color);
-  static U64 get_slider_moves(const int &piece_type, const Square &sq, const U64 &occupied, 
-                              const U64 &same_color);
+  static void add_piece_move(const Board &board, const int from, const int to, Movelist &list);
+  static void add_pawn_moves(const Board &board, U64 moves, const int shift, const U64 pinned,
+                             const int king_sq, const bool capture, const PromotionSet promotions,
+                             Movelist &list);
 private:
   static U64 pawn_attacks(U64 pawns, Color color);
-  static U64 knight_attacks(U64 knights, U64 same_color);
-  static U64 bishop_attacks(U64 bishops, U64 occupied, U64 same_color);
-  static U64 rook_attacks(U64 rooks, U64 occupied, U64 same_color);
-  static U64 queen_attacks(U64 queens, U64 occupied, U64 same_color);
-  static U64 king_attacks(U64 king, U64 same_color);
 };
 
 extern Square int_to_square[64];
+extern const int see_value[13];
+
+// Must be asked before the move is made, the capture is read off the board
+inline bool MoveGenerator::is_capture(const Board &board, const int move) {
+  return board.piece_on[TO_SQUARE(move)] != None || MOVE_TYPE(move) == EnPassant;
+}
+
+// Captures and queen promotions, the moves generate_legal_capture_moves lists
+inline bool MoveGenerator::is_tactical(const Board &board, const int move) {
+  return is_capture(board, move) || (MOVE_TYPE(move) == Promotion && PROMOTION_PIECE(move) == PromoteQueen);
+}
+
+inline int MoveGenerator::captured_piece(const Board &board, const int move) {
+  if (MOVE_TYPE(move) == EnPassant) {
+    return (board.side == White) ? Black_Pawns : White_Pawns;
+  }
+  return board.piece_on[TO_SQUARE(move)];
+}
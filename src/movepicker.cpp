@@ -0,0 +1,158 @@
+#include <cassert>
+
+#include "movepicker.h"
+#include "makemove.h"
+
+MovePicker::MovePicker(const Board &board, SearchContext &context, const int tt_move, const bool captures_only,
+                       const CheckInfo *ci)
+  : board(board), context(context), ci(ci), captures(context.move_buffers[board.ply].captures),
+    quiets(context.move_buffers[board.ply].quiets), tt_move(NOMOVE), stage(TtMove), current(0), bad_end(0), captures_only(captures_only) {
+  captures.count = 0;
+  quiets.count = 0;
+  killers[0] = killers[1] = NOMOVE;
+
+  if (!captures_only && valid_move(tt_move)) {
+    this->tt_move = tt_move;
+  }
+}
+
+int MovePicker::next_move() {
+  int move;
+
+  while (true) {
+    switch (stage) {
+      case TtMove:
+        stage = GenCaptures;
+        if (tt_move != NOMOVE) {
+          return tt_move;
+        }
+        break;
+
+      case GenCaptures:
+        if (ci) {
+          MoveGenerator::generate_legal_capture_moves(board, *ci, captures);
+        }
+        else {
+          MoveGenerator::generate_legal_capture_moves(board, captures);
+        }
+        current = 0;
+        stage = GoodCaptures;
+        break;
+
+      case GoodCaptures:
+        while (current < captures.count) {
+          move = pick_best(captures, current);
+          if (move == tt_move) {
+            current++;
+          }
+          else if (losing_capture(move)) {
+            // Parked at the front, behind the captures already handed out
+            captures.moves[bad_end++] = captures.moves[current++];
+          }
+          else {
+            current++;
+            return move;
+          }
+        }
+        current = 0;
+        stage = captures_only ? Done : Killers;
+        break;
+
+      // A killer that became a capture or queen promotion here was already
+      // handed out above, a second killer equal to the first is skipped
+      case Killers:
+        while (current < 2) {
+          move = context.search_killers[current][board.ply];
+          if (move != tt_move && move != killers[0] && !MoveGenerator::is_tactical(board, move) && valid_move(move)) {
+            killers[current++] = move;
+            return move;
+          }
+          current++;
+        }
+        stage = GenQuiets;
+        break;
+
+      case GenQuiets:
+        if (ci) {
+          MoveGenerator::generate_legal_quiet_moves(board, *ci, quiets);
+        }
+        else {
+          MoveGenerator::generate_legal_quiet_moves(board, quiets);
+        }
+        score_quiets();
+        current = 0;
+        stage = Quiets;
+        break;
+
+      case Quiets:
+        while (current < quiets.count) {
+          move = pick_best(quiets, current++);
+          if (move != tt_move && move != killers[0] && move != killers[1]) {
+            return move;
+          }
+        }
+        current = 0;
+        stage = BadCaptures;
+        break;
+
+      case BadCaptures:
+        if (current < bad_end) {
+          return captures.moves[current++].move;
+        }
+        stage = Done;
+        break;
+
+      case Done:
+        return NOMOVE;
+    }
+  }
+}
+
+// Selection sort step, swaps the best scored move from start onwards into start
+int MovePicker::pick_best(Movelist &list, const int start) {
+  int best_index = start;
+
+  for (int i = start + 1; i < list.count; i++) {
+    if (list.moves[i].score > list.moves[best_index].score) {
+      best_index = i;
+    }
+  }
+
+  Move temp = list.moves[start];
+  list.moves[start] = list.moves[best_index];
+  list.moves[best_index] = temp;
+
+  return list.moves[start].move;
+}
+
+void MovePicker::score_quiets() {
+  for (int i = 0; i < quiets.count; i++) {
+    int move = quiets.moves[i].move;
+    int piece_type = board.piece_on[FROM_SQUARE(move)];
+    assert(piece_type != None);
+
+    int history = context.search_history[piece_type][TO_SQUARE(move)];
+    quiets.moves[i].score = (history < MAX_HISTORY_SCORE) ? history : MAX_HISTORY_SCORE;
+
+    // Helper threads break ties between quiets each their own way
+    if (context.thread_id) {
+      quiets.moves[i].score += ((move >> 3) ^ (context.thread_id * 37)) & 7;
+    }
+  }
+}
+
+bool MovePicker::valid_move(const int move) {
+  bool valid = MoveGenerator::is_pseudo_legal(board, move) && MoveGenerator::is_legal(board, move);
+  assert(valid == (move != NOMOVE && MoveMaker::move_exists(board, move)));
+  return valid;
+}
+
+// Only captures of a cheaper piece can lose material, so the exchange is
+// only worked out for those
+bool MovePicker::losing_capture(const int move) {
+  if (see_value[board.piece_on[FROM_SQUARE(move)]] <= see_value[board.piece_on[TO_SQUARE(move)]]) {
+    return false;
+  }
+
+  return MoveGenerator::see(board, move) < 0;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "movegen.h"
+#include "board.h"
+
+// Lists a picker works in, the search keeps one per ply so recursion doesn't
+// put them on the stack
+typedef struct {
+  Movelist captures;
+  Movelist quiets;
+} MoveBuffer;
+
+// What one searching thread learns and works in, kept apart from the board
+// so every thread has its own
+typedef struct {
+  unsigned short pv_array[MAXDEPTH];
+  int search_history[13][64];
+  unsigned short search_killers[2][MAXDEPTH];
+  MoveBuffer move_buffers[MAXDEPTH];
+  int thread_id;
+  unsigned short root_move;
+  long reported_nodes;
+} SearchContext;
+
+enum PickStage {
+  TtMove, GenCaptures, GoodCaptures, Killers, GenQuiets, Quiets, BadCaptures, Done
+};
+
+/*
+ * Hands out the moves of a node one at a time in stages, so moves after a
+ * cutoff are never generated or sorted:
+ *   1. hash/pv move
+ *   2. captures and queen promotions that don't lose material, by MVV-LVA
+ *   3. the two killers of the ply, tried before any quiet is generated
+ *   4. the other quiets by search_history
+ *   5. captures and queen promotions that lose material by static exchange
+ *      evaluation
+ * The lists are the context's buffers of the ply.
+ * Hash and killer moves are checked against the board with is_pseudo_legal
+ * and is_legal, so they cost no generation of their own.
+ * With captures_only set only the moves of stage 2 are handed out, losing
+ * ones are dropped.
+ * The generator takes the checkers and pins from ci, a node without one
+ * passes null and the generator finds them itself.
+ */
+class MovePicker {
+public:
+  MovePicker(const Board &board, SearchContext &context, const int tt_move, const bool captures_only,
+             const CheckInfo *ci);
+  int next_move();
+private:
+  int pick_best(Movelist &list, const int start);
+  bool losing_capture(const int move);
+  bool valid_move(const int move);
+  void score_quiets();
+
+  const Board &board;
+  const SearchContext &context;
+  const CheckInfo *ci;
+  Movelist &captures;
+  Movelist &quiets;
+  int tt_move;
+  int killers[2];
+  int stage;
+  int current;
+  int bad_end;
+  bool captures_only;
+};
@@ -14,15 +14,13 @@ int Perft::test(int depth, Board &board) {
   int start_time = Time::get_current_time();
 
   Movelist list;
-  MoveGenerator::generate_moves(board, list);
+  MoveGenerator::generate_legal_moves(board, list);
 
   int move; 
   int move_num = 0;
   for (move_num = 0; move_num < list.count; ++move_num) {
     move = list.moves[move_num].move;
-    if (!MoveMaker::make_move(board, move)) {
-      continue;
-    }
+    MoveMaker::make_move(board, move);
     long cumnodes = leaf_nodes;
     perft(depth - 1, board);
     MoveMaker::take_move(board);
@@ -41,15 +39,13 @@ int Perft::test_no_print(int depth, Board &board) {
   leaf_nodes = 0;
 
   Movelist list;
-  MoveGenerator::generate_moves(board, list);
+  MoveGenerator::generate_legal_moves(board, list);
 
   int move; 
   int move_num = 0;
   for (move_num = 0; move_num < list.count; ++move_num) {
     move = list.moves[move_num].move;
-    if (!MoveMaker::make_move(board, move)) {
-      continue;
-    }
+    MoveMaker::make_move(board, move);
     long cumnodes = leaf_nodes;
     perft(depth - 1, board);
     MoveMaker::take_move(board);
@@ -61,6 +57,51 @@ int Perft::test_no_print(int depth, Board &board) {
   return leaf_nodes;
 }
 
+// Runs the same perft once per slider attack backend so their speed can be
+// compared on this machine
+void Perft::bench(int depth, Board &board) {
+  SliderBackend chosen = BitBoard::slider_backend;
+
+  std::cout << "Bench perft depth " << depth << std::endl;
+
+  for (int backend = Magics; backend <= Pext; backend++) {
+    const char *name = BitBoard::slider_backend_names[backend];
+    if (backend == Pext && !BitBoard::pext_supported()) {
+      std::cout << name << ": not supported on this cpu" << std::endl;
+      continue;
+    }
+
+    BitBoard::set_slider_backend((SliderBackend) backend);
+
+    int start_time = Time::get_current_time();
+    long nodes = test_no_print(depth, board);
+    int elapsed = Time::get_current_time() - start_time;
+
+    std::cout << name << ": " << nodes << " nodes " << elapsed << "ms "
+              << (elapsed ? nodes * 1000 / elapsed : 0) << " nps"
+              << (backend == chosen ? " (selected)" : "") << std::endl;
+  }
+
+  BitBoard::set_slider_backend(chosen);
+
+  // Undoing moves by hand against restoring a saved copy of the position
+  bool copy_make = MoveMaker::copy_make;
+
+  for (int mode = 0; mode < 2; mode++) {
+    MoveMaker::copy_make = mode;
+
+    int start_time = Time::get_current_time();
+    long nodes = test_no_print(depth, board);
+    int elapsed = Time::get_current_time() - start_time;
+
+    std::cout << (mode ? "copy-make" : "make/take") << ": " << nodes << " nodes " << elapsed << "ms "
+              << (elapsed ? nodes * 1000 / elapsed : 0) << " nps"
+              << (mode == copy_make ? " (selected)" : "") << std::endl;
+  }
+
+  MoveMaker::copy_make = copy_make;
+}
+
 void Perft::perft(int depth, Board &board) {
   if (depth == 0) {
     leaf_nodes++;
@@ -68,7 +109,13 @@ void Perft::perft(int depth, Board &board) {
   }
 
   Movelist list;
-  MoveGenerator::generate_moves(board, list);
+  MoveGenerator::generate_legal_moves(board, list);
+
+  // Every generated move is legal, so the last ply only needs counting
+  if (depth == 1) {
+    leaf_nodes += list.count;
+    return;
+  }
 
   int move_num = 0;
   int move = 0;
@@ -77,9 +124,7 @@ void Perft::perft(int depth, Board &board) {
     move = list.moves[move_num].move;
 
     //board.print_board();
-    if (!MoveMaker::make_move(board, move)) {
-      continue;
-    }
+    MoveMaker::make_move(board, move);
     perft(depth - 1, board);
     MoveMaker::take_move(board);
   }
@@ -1,57 +1,297 @@
 #include <iostream>
+#include <iomanip>
 #include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <thread>
 
 #include "search.h"
 #include "makemove.h"
-#include "pvtable.h"
+#include "transtable.h"
 #include "evaluate.h"
 #include "time.h"
 #include "uci.h"
 
 #define INFINITE 30000
 #define MATE 29000
+#define DELTA_MARGIN 200
+#define IS_MATE (MATE - MAXDEPTH)
+#define ASPIRATION_WINDOW 25
+#define LMR_MIN_DEPTH 3
+#define LMR_MIN_MOVES 3
+#define LMP_MAX_DEPTH 3
+#define NULL_MIN_DEPTH 3
+#define NULL_VERIFY_DEPTH 8
+
+int Searcher::num_threads = 1;
+std::vector<SearchThread> Searcher::threads(1);
+std::atomic<bool> Searcher::stop(false);
+std::atomic<long> Searcher::helper_nodes(0);
+int Searcher::reductions[MAXDEPTH][MAX_POSITION_MOVES];
+
+/*
+ * Helpers skip some depths so the threads don't all search the same iteration
+ * at once, helper i skips depth d when ((d + phase) / size) is odd. Together
+ * with the shared table and their own move ordering this spreads them over
+ * the tree.
+ */
+static const int skip_size[20] = { 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4 };
+static const int skip_phase[20] = { 0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7 };
+
+// Mate scores go into the table as distance from the node rather than from
+// the root, so they stay right wherever the position comes up again
+static int score_to_tt(const int score, const int ply) {
+  if (score > IS_MATE) return score + ply;
+  if (score < -IS_MATE) return score - ply;
+  return score;
+}
+
+static int score_from_tt(const int score, const int ply) {
+  if (score > IS_MATE) return score - ply;
+  if (score < -IS_MATE) return score + ply;
+  return score;
+}
+
+/*
+ * Late quiet moves are searched less deep, more so the deeper the node and the
+ * later the move, as most cutoffs come from the first few moves:
+ *   reduction = 0.75 + ln(depth) * ln(move number) / 2.25
+ */
+void Searcher::init() {
+  for (int depth = 0; depth < MAXDEPTH; depth++) {
+    for (int moves = 0; moves < MAX_POSITION_MOVES; moves++) {
+      reductions[depth][moves] = (depth && moves) ? (int) (0.75 + std::log(depth) * std::log(moves) / 2.25) : 0;
+    }
+  }
+}
 
+// Without pieces other than pawns zugzwang is too common to pass a move
+static bool has_non_pawn_material(const Board &board) {
+  if (board.side == White) {
+    return board.pieces[White_Knights] | board.pieces[White_Bishops] | board.pieces[White_Rooks] |
+           board.pieces[White_Queens];
+  }
+  return board.pieces[Black_Knights] | board.pieces[Black_Bishops] | board.pieces[Black_Rooks] |
+         board.pieces[Black_Queens];
+}
+
+void Searcher::set_threads(const int count) {
+  num_threads = (count < 1) ? 1 : (count > MAX_THREADS) ? MAX_THREADS : count;
+  threads.resize(num_threads);
+}
+
+/*
+ * Lazy SMP, every thread searches the same root with its own board, killers
+ * and history and only the transposition table is shared. The main thread
+ * reads input, keeps time and reports, the helpers run until it stops them.
+ * The move played comes from the thread that finished the deepest iteration.
+ */
 void Searcher::search_position(Board &board, SearchInfo &info) {
-  int best_move = NOMOVE;
-  int best_score = -INFINITE;
-  int current_depth = 0;
-  int pv_moves = 0;
-  int pv_num = 0;
+  TransTable::new_search();
+  stop = false;
+  helper_nodes = 0;
+
+  for (int i = 0; i < num_threads; i++) {
+    SearchThread &thread = threads[i];
+    thread.board = board;
+    thread.info = info;
+    thread.context.thread_id = i;
+    thread.depth = 0;
+    thread.score = -INFINITE;
+    thread.best_move = NOMOVE;
+    clear_for_search(thread.board, thread.context, thread.info);
+  }
+
+  std::vector<std::thread> helpers;
+  for (int i = 1; i < num_threads; i++) {
+    helpers.emplace_back(iterate, std::ref(threads[i]));
+  }
+
+  iterate(threads[0]);
+  stop = true;
+
+  for (std::thread &helper : helpers) {
+    helper.join();
+  }
+
+  SearchThread *best = &threads[0];
+  for (int i = 1; i < num_threads; i++) {
+    if (threads[i].depth > best->depth || (threads[i].depth == best->depth && threads[i].score > best->score)) {
+      best = &threads[i];
+    }
+  }
+
+  info.nodes = threads[0].info.nodes + helper_nodes;
+  info.stopped = threads[0].info.stopped;
+  info.quit = threads[0].info.quit;
+  info.fail_high = threads[0].info.fail_high;
+  info.fail_high_first = threads[0].info.fail_high_first;
+
+  std::cout << "bestmove " << MoveGenerator::get_move(best->best_move) << std::endl;
+}
+
+/*
+ * Fixed positions searched to a fixed depth, each from an empty table, so with
+ * one thread the node count is the same every run and only the time changes.
+ * Run as "bench search [depth]", it honors the Threads option.
+ */
+static const char *bench_fens[] = {
+  "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+  "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+  "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP1QBPPP/R3KB1R w KQ - 0 9",
+  "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+  "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+};
+
+void Searcher::run_bench(const int depth, long &nodes, int &elapsed) {
+  static Board board;
+  nodes = 0;
+  elapsed = 0;
+
+  for (const char *fen : bench_fens) {
+    char buffer[128];
+    strcpy(buffer, fen);
+    board.parse_fen(buffer);
+    TransTable::clear();
+
+    SearchInfo info;
+    memset(&info, 0, sizeof(info));
+    info.depth = depth;
+    info.bench = true;
+    info.start_time = Time::get_current_time();
+
+    search_position(board, info);
+
+    elapsed += Time::get_current_time() - info.start_time;
+    nodes += info.nodes;
+  }
+}
+
+void Searcher::bench(const int depth) {
+  long nodes;
+  int elapsed;
+  run_bench(depth, nodes, elapsed);
+
+  std::cout << "bench depth " << depth << " threads " << num_threads << ": " << nodes << " nodes " << elapsed
+            << "ms " << (elapsed ? nodes * 1000 / elapsed : 0) << " nps" << std::endl;
+}
+
+/*
+ * Lazy SMP scaling, the search bench with 1, 2, 4, 8 and 16 threads. Time to
+ * depth and nps are given relative to one thread, more threads search more
+ * nodes for the same depth so both are needed. Run as "bench threads [depth]",
+ * the Threads option is restored afterwards.
+ */
+void Searcher::bench_threads(const int depth) {
+  static const int counts[] = { 1, 2, 4, 8, 16 };
+  int saved_threads = num_threads;
+  long nodes[5];
+  int elapsed[5];
+
+  for (int i = 0; i < 5; i++) {
+    set_threads(counts[i]);
+    run_bench(depth, nodes[i], elapsed[i]);
+  }
+  set_threads(saved_threads);
+
+  std::cout << "bench depth " << depth << " on " << std::thread::hardware_concurrency() << " cores" << std::endl;
+  std::cout << "threads     nodes   time(ms)        nps  time-to-depth  nps-speedup" << std::endl;
+  long base_nps = elapsed[0] ? nodes[0] * 1000 / elapsed[0] : 0;
+  for (int i = 0; i < 5; i++) {
+    long nps = elapsed[i] ? nodes[i] * 1000 / elapsed[i] : 0;
+    std::cout << std::setw(7) << counts[i] << std::setw(10) << nodes[i] << std::setw(11) << elapsed[i]
+              << std::setw(11) << nps << std::fixed << std::setprecision(2)
+              << std::setw(14) << (elapsed[i] ? (double) elapsed[0] / elapsed[i] : 0.0) << "x"
+              << std::setw(12) << (base_nps ? (double) nps / base_nps : 0.0) << "x" << std::endl;
+  }
+}
 
-  clear_for_search(board, info);
+void Searcher::iterate(SearchThread &thread) {
+  Board &board = thread.board;
+  SearchContext &context = thread.context;
+  SearchInfo &info = thread.info;
+  int id = context.thread_id;
 
-  for (current_depth = 1; current_depth <= info.depth; current_depth++) {
-    best_score = alpha_beta(-INFINITE, INFINITE, current_depth, board, info, true);
+  int king_sq = BitBoard::bit_scan_forward(board.pieces[(board.side == White) ? White_King : Black_King]);
+  bool in_check = MoveGenerator::square_attacked(int_to_square[king_sq], (board.side == White) ? Black : White, board);
+
+  for (int current_depth = 1; current_depth <= info.depth; current_depth++) {
+    if (id && ((current_depth + skip_phase[(id - 1) % 20]) / skip_size[(id - 1) % 20]) % 2) {
+      continue;
+    }
+
+    // Aspiration window around the last score, widened on the failing side
+    // until the score falls inside. Mate scores get the full window.
+    int delta = ASPIRATION_WINDOW;
+    int alpha = -INFINITE;
+    int beta = INFINITE;
+    if (current_depth >= 4 && thread.depth && std::abs(thread.score) < IS_MATE) {
+      alpha = std::max(thread.score - delta, -INFINITE);
+      beta = std::min(thread.score + delta, INFINITE);
+    }
+
+    int score;
+    while (true) {
+      score = alpha_beta(alpha, beta, current_depth, board, context, info, in_check, true);
+
+      if (info.stopped || (score > alpha && score < beta)) {
+        break;
+      }
+
+      if (id == 0) {
+        std::cout << "info score cp " << score << ((score <= alpha) ? " upperbound" : " lowerbound")
+                  << " depth " << current_depth << " nodes " << info.nodes + helper_nodes
+                  << " time " << Time::get_current_time() - info.start_time << std::endl;
+      }
+
+      delta *= 2;
+      if (score <= alpha) {
+        alpha = std::max(score - delta, -INFINITE);
+      }
+      else {
+        beta = std::min(score + delta, INFINITE);
+      }
+    }
 
     if (info.stopped) {
       break;
     }
 
-    pv_moves = PvTable::get_pv_line(current_depth, board);
-    best_move = board.pv_array[0];
+    thread.depth = current_depth;
+    thread.score = score;
+    thread.best_move = context.root_move;
+
+    if (id) {
+      continue;
+    }
 
-    std::cout << "info score cp " << best_score << " depth " << current_depth << " nodes "
-              << info.nodes << " time " << Time::get_current_time() - info.start_time << " ";
+    std::cout << "info score cp " << score << " depth " << current_depth << " nodes "
+              << info.nodes + helper_nodes << " time " << Time::get_current_time() - info.start_time << " ";
 
-    pv_moves = PvTable::get_pv_line(4, board);
+    int pv_moves = TransTable::get_pv_line(4, board, context.pv_array);
     std::cout << "pv";
     for (int pv_num = 0; pv_num < pv_moves; pv_num++) {
-      std::cout << " " << MoveGenerator::get_move(board.pv_array[pv_num]);
+      std::cout << " " << MoveGenerator::get_move(context.pv_array[pv_num]);
     }
     std::cout << std::endl;
   }
 
-  std::cout << "bestmove " << MoveGenerator::get_move(best_move) << std::endl;
+  if (id) {
+    helper_nodes += info.nodes - context.reported_nodes;
+  }
 }
 
-int Searcher::alpha_beta(int alpha, int beta, int depth, Board &board, SearchInfo &info, bool do_null) {
+int Searcher::alpha_beta(int alpha, int beta, int depth, Board &board, SearchContext &context, SearchInfo &info,
+                         bool in_check, bool do_null) {
   if (depth == 0) {
     info.nodes++;
-    return quiescence(alpha, beta, board, info);
+    return quiescence(alpha, beta, board, context, info);
   }
 
   if ((info.nodes & 2047) == 0) {
-    check_up(info);
+    check_up(context, info);
   }
 
   info.nodes++;
@@ -64,49 +304,113 @@ int Searcher::alpha_beta(int alpha, int beta, int depth, Board &board, SearchInf
     return Evaluator::evaluate_positon(board);
   }
 
-  U64 king_bitboard;
-  Color attacker_color;
-
-  if (board.side == White) {
-    king_bitboard = board.pieces[White_King];
-    attacker_color = Black;
-  }
-  else {
-    king_bitboard = board.pieces[Black_King];
-    attacker_color = White;
-  }
-  int king_square = BitBoard::bit_scan_forward(king_bitboard);
-  if (MoveGenerator::square_attacked(int_to_square[king_square], attacker_color, board)) {
-    depth++;
+  // An earlier search of this position at least as deep ends the node when
+  // its bound settles it, except at the root which has to come up with a move
+  U64 tt_data = 0ULL;
+  bool tt_hit = TransTable::probe(board, tt_data);
+  if (tt_hit && board.ply && TT_DEPTH(tt_data) >= depth) {
+    int tt_score = score_from_tt(TT_SCORE(tt_data), board.ply);
+    int bound = TT_BOUND(tt_data);
+    if (bound == ExactBound || (bound == LowerBound && tt_score >= beta) ||
+        (bound == UpperBound && tt_score <= alpha)) {
+      return std::max(alpha, std::min(beta, tt_score));
+    }
   }
 
-  Movelist list;
-  MoveGenerator::generate_moves(board, list);
+  int eval = tt_hit ? TT_EVAL(tt_data) : Evaluator::evaluate_positon(board);
+
+  // Checks are known before a move is made, so in_check comes from the parent
+  // and the check extension is given there
+  CheckInfo ci;
+  MoveGenerator::check_info(board, in_check, ci);
+  assert(in_check == MoveGenerator::square_attacked(
+      int_to_square[BitBoard::bit_scan_forward(board.pieces[(board.side == White) ? White_King : Black_King])],
+      (board.side == White) ? Black : White, board));
+
+  bool pv_node = beta - alpha > 1;
+
+  /*
+   * Null move pruning, if passing the move to the opponent still fails high
+   * in a reduced search the node is taken to fail high. The reduction grows a
+   * ply every six plies of depth. Deep nodes are verified with a reduced
+   * search of their own moves, so zugzwang doesn't cut them off. Not tried
+   * around mate scores, a pass is no proof of a mate.
+   */
+  if (do_null && !pv_node && !in_check && board.ply && depth >= NULL_MIN_DEPTH && eval >= beta &&
+      std::abs(beta) < IS_MATE && has_non_pawn_material(board)) {
+    int reduction = 3 + depth / 6;
+    int null_depth = std::max(0, depth - 1 - reduction);
+
+    MoveMaker::make_null_move(board);
+    TransTable::prefetch(board.position_key);
+    int null_score = -alpha_beta(-beta, -beta + 1, null_depth, board, context, info, false, false);
+    MoveMaker::take_null_move(board);
+
+    if (info.stopped) {
+      return 0;
+    }
+
+    if (null_score >= beta) {
+      if (depth < NULL_VERIFY_DEPTH ||
+          alpha_beta(beta - 1, beta, std::max(1, depth - reduction), board, context, info, false, false) >= beta) {
+        return beta;
+      }
+      if (info.stopped) {
+        return 0;
+      }
+    }
+  }
 
-  int move_num = 0;
   int legal = 0;
   int old_alpha = alpha;
   int best_move = NOMOVE;
   int score = -INFINITE;
-  int pv_move = PvTable::probe_table(board);
+  int move;
 
-  if (pv_move != NOMOVE) {
-    for (move_num = 0; move_num < list.count; move_num++) {
-      if (list.moves[move_num].move == pv_move) {
-        list.moves[move_num].score = 2000000;
-      }
-    }
-  }
+  MovePicker picker(board, context, tt_hit ? TT_MOVE(tt_data) : NOMOVE, false, &ci);
 
-  for (move_num = 0; move_num < list.count; move_num++) {
-    pick_next_move(move_num, list);
+  while ((move = picker.next_move()) != NOMOVE) {
+    bool gives_check = MoveGenerator::gives_check(board, ci, move);
+    bool quiet = !MoveGenerator::is_capture(board, move) && MOVE_TYPE(move) != Promotion;
+    bool killer = move == context.search_killers[0][board.ply] || move == context.search_killers[1][board.ply];
+    int history = context.search_history[board.piece_on[FROM_SQUARE(move)]][TO_SQUARE(move)];
 
-    if (!MoveMaker::make_move(board, list.moves[move_num].move)) {
+    // Late move pruning, near the leaves the quiets at the end of the order
+    // are skipped once enough moves have been searched. Never when mated.
+    if (!pv_node && !in_check && quiet && !gives_check && depth <= LMP_MAX_DEPTH && alpha > -IS_MATE &&
+        legal >= 3 + depth * depth) {
       continue;
     }
 
+    MoveMaker::make_move(board, move);
+    TransTable::prefetch(board.position_key);
     legal++;
-    score = -alpha_beta(-beta, -alpha, depth - 1, board, info, true);
+
+    int new_depth = depth - 1 + gives_check;
+
+    // Late move reduction, less for the pv, killers and moves with a history.
+    // A reduced move that beats alpha is searched again to the full depth.
+    int reduction = 0;
+    if (depth >= LMR_MIN_DEPTH && legal > LMR_MIN_MOVES && quiet && !in_check && !gives_check) {
+      reduction = reductions[std::min(depth, MAXDEPTH - 1)][std::min(legal, MAX_POSITION_MOVES - 1)];
+      reduction -= pv_node + killer + (history > 0);
+      reduction = std::max(0, std::min(reduction, new_depth - 1));
+    }
+
+    // Principal variation search, after the first move a null window only
+    // proves the move is no better, it is searched again if it is
+    if (legal == 1) {
+      score = -alpha_beta(-beta, -alpha, new_depth, board, context, info, gives_check, true);
+    }
+    else {
+      score = -alpha_beta(-alpha - 1, -alpha, new_depth - reduction, board, context, info, gives_check, true);
+      if (reduction && score > alpha) {
+        score = -alpha_beta(-alpha - 1, -alpha, new_depth, board, context, info, gives_check, true);
+      }
+      if (score > alpha && score < beta) {
+        score = -alpha_beta(-beta, -alpha, new_depth, board, context, info, gives_check, true);
+      }
+    }
     MoveMaker::take_move(board);
 
     if (info.stopped) {
@@ -120,64 +424,46 @@ int Searcher::alpha_beta(int alpha, int beta, int depth, Board &board, SearchInf
         }
         info.fail_high++;
 
-        if (!(list.moves[move_num].move & (0xF << 24))) {
-          board.search_killers[1][board.ply] = board.search_killers[0][board.ply]; 
-          board.search_killers[0][board.ply] = list.moves[move_num].move;
+        // Shifted only for a new killer, so the two never hold the same move
+        if (!MoveGenerator::is_tactical(board, move) && move != context.search_killers[0][board.ply]) {
+          context.search_killers[1][board.ply] = context.search_killers[0][board.ply];
+          context.search_killers[0][board.ply] = move;
         }
 
+        TransTable::store(board, move, score_to_tt(beta, board.ply), eval, depth, LowerBound);
         return beta;
       }
       alpha = score;
-      best_move = list.moves[move_num].move;
-
-      if (!(list.moves[move_num].move & (0xF << 24))) {
-        int from = FROM_SQUARE(list.moves[move_num].move);
-        U64 from_bitboard = 1ULL << from;
-        int piece_type;
-        for (piece_type = White_Pawns; piece_type <= Black_King; piece_type++) {
-          if (board.pieces[piece_type] & from_bitboard) {
-            break; 
-          }
-        }
-        assert(piece_type != 13);
+      best_move = move;
 
-        board.search_history[piece_type][TO_SQUARE(best_move)] += depth;
+      if (board.ply == 0) {
+        context.root_move = move;
       }
-    }
-  }
 
-  if (legal == 0) {
-    Color attacker_side;
-    U64 king_bitboard;
+      if (!MoveGenerator::is_tactical(board, move)) {
+        int piece_type = board.piece_on[FROM_SQUARE(best_move)];
+        assert(piece_type != None);
 
-    if (board.side == White) {
-      attacker_side = Black;
-      king_bitboard = board.pieces[White_King];
-    }
-    else {
-      attacker_side = White;
-      king_bitboard = board.pieces[Black_King];
-    }
-    
-    int king_square = BitBoard::bit_scan_forward(king_bitboard);
-    if (MoveGenerator::square_attacked(int_to_square[king_square], attacker_side, board)) {
-      return -MATE + board.ply;
-    }
-    else {
-      return 0;
+        context.search_history[piece_type][TO_SQUARE(best_move)] += depth;
+      }
     }
   }
 
-  if (alpha != old_alpha) {
-    PvTable::store_move(board, best_move);
+  if (legal == 0) {
+    score = in_check ? -MATE + board.ply : 0;
+    TransTable::store(board, NOMOVE, score_to_tt(score, board.ply), eval, depth, ExactBound);
+    return score;
   }
 
+  TransTable::store(board, best_move, score_to_tt(alpha, board.ply), eval, depth,
+                    (alpha != old_alpha) ? ExactBound : UpperBound);
+
   return alpha;
 }
 
-int Searcher::quiescence(int alpha, int beta, Board &board, SearchInfo &info) {
+int Searcher::quiescence(int alpha, int beta, Board &board, SearchContext &context, SearchInfo &info) {
   if ((info.nodes & 2047) == 0) {
-    check_up(info);
+    check_up(context, info);
   }
 
   info.nodes++;
@@ -190,35 +476,52 @@ int Searcher::quiescence(int alpha, int beta, Board &board, SearchInfo &info) {
     return Evaluator::evaluate_positon(board);
   }
 
-  int score = Evaluator::evaluate_positon(board);
+  // Any stored result is at least as deep as a quiescence search
+  U64 tt_data = 0ULL;
+  bool tt_hit = TransTable::probe(board, tt_data);
+  if (tt_hit) {
+    int tt_score = score_from_tt(TT_SCORE(tt_data), board.ply);
+    int bound = TT_BOUND(tt_data);
+    if (bound == ExactBound || (bound == LowerBound && tt_score >= beta) ||
+        (bound == UpperBound && tt_score <= alpha)) {
+      return std::max(alpha, std::min(beta, tt_score));
+    }
+  }
+
+  int old_alpha = alpha;
+  int stand_pat = tt_hit ? TT_EVAL(tt_data) : Evaluator::evaluate_positon(board);
 
-  if (score >= beta) {
+  if (stand_pat >= beta) {
+    TransTable::store(board, NOMOVE, score_to_tt(beta, board.ply), stand_pat, 0, LowerBound);
     return beta;
   }
 
-  if (score > alpha) {
-    alpha = score;
+  if (stand_pat > alpha) {
+    alpha = stand_pat;
   }
 
-  Movelist list;
-  MoveGenerator::generate_capture_moves(board, list);
+  int score;
 
-  int move_num = 0;
   int legal = 0;
-  int old_alpha = alpha;
   int best_move = NOMOVE;
+  int move;
   score = -INFINITE;
-  int pv_move = PvTable::probe_table(board);
 
-  for (move_num = 0; move_num < list.count; move_num++) {
-    pick_next_move(move_num, list);
+  // Captures losing material by SEE never leave the picker
+  MovePicker picker(board, context, NOMOVE, true, nullptr);
 
-    if (!MoveMaker::make_move(board, list.moves[move_num].move)) {
+  while ((move = picker.next_move()) != NOMOVE) {
+    // Delta pruning, skip captures that would stay below alpha even with the
+    // captured piece and a margin added to the static evaluation
+    if (MOVE_TYPE(move) != Promotion &&
+        stand_pat + see_value[MoveGenerator::captured_piece(board, move)] + DELTA_MARGIN <= alpha) {
       continue;
     }
 
+    MoveMaker::make_move(board, move);
+    TransTable::prefetch(board.position_key);
     legal++;
-    score = -quiescence(-beta, -alpha, board, info);
+    score = -quiescence(-beta, -alpha, board, context, info);
     MoveMaker::take_move(board);
 
     if (info.stopped) {
@@ -231,61 +534,61 @@ int Searcher::quiescence(int alpha, int beta, Board &board, SearchInfo &info) {
           info.fail_high_first++;
         }
         info.fail_high++;
+        TransTable::store(board, move, score_to_tt(beta, board.ply), stand_pat, 0, LowerBound);
         return beta;
       }
       alpha = score;
-      best_move = list.moves[move_num].move;
+      best_move = move;
     }
   }
-  
-  if (alpha != old_alpha) {
-    PvTable::store_move(board, best_move);
-  }
+
+  TransTable::store(board, best_move, score_to_tt(alpha, board.ply), stand_pat, 0,
+                    (alpha != old_alpha) ? ExactBound : UpperBound);
 
   return alpha;
 }
 
-void Searcher::pick_next_move(int move_num, Movelist &list) {
-  Move temp;
-
-  int best_score = 0;
-  int best_index = move_num;
-  
-  for (int i = move_num; i < list.count; i++) {
-    if (list.moves[i].score > best_score) {
-      best_score = list.moves[i].score;
-      best_index = i;
+// Helpers only watch for the main thread stopping them and hand it their
+// node count in steps, so it can be reported without touching their state
+void Searcher::check_up(SearchContext &context, SearchInfo &info) {
+  if (context.thread_id) {
+    helper_nodes += info.nodes - context.reported_nodes;
+    context.reported_nodes = info.nodes;
+    if (stop) {
+      info.stopped = true;
     }
+    return;
   }
 
-  temp = list.moves[move_num];
-  list.moves[move_num] = list.moves[best_index];
-  list.moves[best_index] = temp;
-}
-
-void Searcher::check_up(SearchInfo &info) {
   if (info.time_set == true && Time::get_current_time() > info.stop_time) {
     info.stopped = true;
   }
 
-  Uci::read_input(info);
+  if (!info.bench) {
+    Uci::read_input(info);
+  }
+
+  if (info.stopped) {
+    stop = true;
+  }
 }
 
-void Searcher::clear_for_search(Board &board, SearchInfo &info) {
+void Searcher::clear_for_search(Board &board, SearchContext &context, SearchInfo &info) {
   for (int i = 0; i < 13; i++) {
     for (int j = 0; j < 64; j++) {
-      board.search_history[i][j] = 0;
+      context.search_history[i][j] = 0;
     }
   }
 
   for (int i = 0; i < 2; i++) {
     for (int j = 0; j < MAXDEPTH; j++) {
-      board.search_killers[i][j] = 0;
+      context.search_killers[i][j] = 0;
     }
   }
 
-  PvTable::clear();
   board.ply = 0;
+  context.root_move = NOMOVE;
+  context.reported_nodes = 0;
 
   info.stopped = 0;
   info.nodes = 0;
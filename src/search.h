@@ -1,6 +1,9 @@
 #pragma once
 
+#include <atomic>
+#include <vector>
 #include "movegen.h"
+#include "movepicker.h"
 #include "board.h"
 
 typedef struct {
@@ -11,6 +14,9 @@ typedef struct {
   int time_set;
   int moves_to_go;
   int infinite;
+  // Set by the search bench, the search then runs to depth without reading
+  // input
+  int bench;
 
   long nodes;
   int quit;
@@ -20,14 +26,36 @@ typedef struct {
   float fail_high_first;
 } SearchInfo;
 
+#define MAX_THREADS 64
+
+// One thread of the Lazy SMP search, each searches its own copy of the board
+typedef struct {
+  Board board;
+  SearchContext context;
+  SearchInfo info;
+  // Result of the deepest iteration the thread finished
+  int depth, score, best_move;
+} SearchThread;
+
 class Searcher {
 public:
+  static void init();
   static void search_position(Board &board, SearchInfo &info);
+  static void set_threads(const int count);
+  static void bench(const int depth);
+  static void bench_threads(const int depth);
+  static int num_threads;
 private:
-  static void check_up(SearchInfo &info);
-  static void clear_for_search(Board &board, SearchInfo &info);
-  static int alpha_beta(int alpha, int beta, int depth, Board &board, SearchInfo &info, bool do_null);
-  static int quiescence(int alpha, int beta, Board &board, SearchInfo &info);
-  static void pick_next_move(int move_num, Movelist &list);
+  static void iterate(SearchThread &thread);
+  static void check_up(SearchContext &context, SearchInfo &info);
+  static void run_bench(const int depth, long &nodes, int &elapsed);
+  static void clear_for_search(Board &board, SearchContext &context, SearchInfo &info);
+  static int alpha_beta(int alpha, int beta, int depth, Board &board, SearchContext &context, SearchInfo &info,
+                        bool in_check, bool do_null);
+  static int quiescence(int alpha, int beta, Board &board, SearchContext &context, SearchInfo &info);
   static bool is_repetition(const Board &board);
+  static std::vector<SearchThread> threads;
+  static std::atomic<bool> stop;
+  static std::atomic<long> helper_nodes;
+  static int reductions[MAXDEPTH][MAX_POSITION_MOVES];
 };
@@ -0,0 +1,153 @@
+#include <iostream>
+#include <cassert>
+#include <stdlib.h>
+#include "transtable.h"
+#include "movegen.h"
+#include "makemove.h"
+
+TtBucket *TransTable::table = 0;
+U64 TransTable::num_buckets = 0;
+int TransTable::generation = 0;
+
+// The bucket count is a power of two, so the low bits of the key pick it
+static inline U64 bucket_index(const U64 key, const U64 num_buckets) {
+  return key & (num_buckets - 1);
+}
+
+bool TransTable::probe(const Board &board, U64 &data) {
+  TtBucket &bucket = table[bucket_index(board.position_key, num_buckets)];
+
+  for (int i = 0; i < TT_ENTRIES_PER_BUCKET; i++) {
+    U64 key = bucket.entries[i].key.load(std::memory_order_relaxed);
+    U64 entry_data = bucket.entries[i].data.load(std::memory_order_relaxed);
+    if ((key ^ entry_data) == board.position_key) {
+      data = entry_data;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// Started right after make_move, so the bucket is on its way while the
+// child node does its first checks
+void TransTable::prefetch(const U64 key) {
+#if defined(__GNUC__)
+  __builtin_prefetch(&table[bucket_index(key, num_buckets)]);
+#endif
+}
+
+int TransTable::probe_move(const Board &board) {
+  U64 data;
+  return probe(board, data) ? TT_MOVE(data) : NOMOVE;
+}
+
+/*
+ * An entry of the same position is overwritten by an exact result, a result
+ * at most TT_DEPTH_SLACK plies shallower or when it is left from an earlier
+ * search. Otherwise it keeps its result and only takes the new move and the
+ * current generation, so quiescence and reduced searches don't wipe out deep
+ * results. An entry of another position is replaced by the one worth the
+ * least, every search it has aged costs it as much as eight plies of depth so
+ * old deep results don't fill the table forever. Empty entries have a zero
+ * key and depth and go first.
+ */
+void TransTable::store(const Board &board, const int move, const int score, const int eval, const int depth,
+                       const int bound) {
+  assert(depth >= 0 && depth < 256);
+  assert(score > -32768 && score < 32768);
+
+  TtBucket &bucket = table[bucket_index(board.position_key, num_buckets)];
+  TtEntry *replace = &bucket.entries[0];
+  int replace_worth = 0x7FFFFFFF;
+
+  for (int i = 0; i < TT_ENTRIES_PER_BUCKET; i++) {
+    TtEntry *entry = &bucket.entries[i];
+    U64 old_key = entry->key.load(std::memory_order_relaxed);
+    U64 old_data = entry->data.load(std::memory_order_relaxed);
+
+    if ((old_key ^ old_data) == board.position_key) {
+      int keep_move = (move == NOMOVE) ? TT_MOVE(old_data) : move;
+      U64 data = TT_DATA(keep_move, score, eval, depth, bound, generation);
+
+      if (bound != ExactBound && depth + TT_DEPTH_SLACK < TT_DEPTH(old_data) &&
+          TT_GENERATION(old_data) == generation) {
+        data = TT_DATA(keep_move, TT_SCORE(old_data), TT_EVAL(old_data), TT_DEPTH(old_data), TT_BOUND(old_data),
+                       generation);
+      }
+
+      entry->key.store(board.position_key ^ data, std::memory_order_relaxed);
+      entry->data.store(data, std::memory_order_relaxed);
+      return;
+    }
+
+    int age = (generation - TT_GENERATION(old_data)) & 0x3F;
+    int worth = (old_key == 0ULL) ? -0x7FFFFFFF : TT_DEPTH(old_data) - 8 * age;
+    if (worth < replace_worth) {
+      replace = entry;
+      replace_worth = worth;
+    }
+  }
+
+  U64 data = TT_DATA(move, score, eval, depth, bound, generation);
+  replace->key.store(board.position_key ^ data, std::memory_order_relaxed);
+  replace->data.store(data, std::memory_order_relaxed);
+}
+
+int TransTable::get_pv_line(const int depth, Board &board, unsigned short *pv_array) {
+  assert(depth < MAXDEPTH);
+
+  int move = probe_move(board);
+  int count = 0;
+
+  while (move != NOMOVE && count < depth) {
+    assert(count < MAXDEPTH);
+
+    if (MoveGenerator::is_pseudo_legal(board, move) && MoveGenerator::is_legal(board, move)) {
+      MoveMaker::make_move(board, move);
+      pv_array[count++] = move;
+    }
+    else {
+      break;
+    }
+    move = probe_move(board);
+  }
+
+  while (board.ply > 0) {
+    MoveMaker::take_move(board);
+  }
+
+  return count;
+}
+
+void TransTable::new_search() {
+  generation = (generation + 1) & 0x3F;
+}
+
+void TransTable::init(const int megabytes) {
+  U64 bytes = (U64) megabytes * 0x100000;
+
+  num_buckets = 1;
+  while (num_buckets * 2 * sizeof(TtBucket) <= bytes) {
+    num_buckets *= 2;
+  }
+
+  table = (TtBucket*) aligned_alloc(64, num_buckets * sizeof(TtBucket));
+  clear();
+
+  std::cout << "TransTable init complete with " << num_buckets * TT_ENTRIES_PER_BUCKET << " entries" << std::endl;
+}
+
+void TransTable::clear() {
+  for (TtBucket *bucket = table; bucket < table + num_buckets; bucket++) {
+    for (int i = 0; i < TT_ENTRIES_PER_BUCKET; i++) {
+      bucket->entries[i].key.store(0ULL, std::memory_order_relaxed);
+      bucket->entries[i].data.store(0ULL, std::memory_order_relaxed);
+    }
+  }
+  generation = 0;
+}
+
+void TransTable::free_table() {
+  free(table);
+}
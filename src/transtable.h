@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include "board.h"
+
+#define TT_ENTRIES_PER_BUCKET 4
+#define TT_DEFAULT_MB 64
+// How much shallower a result may be and still replace one of the same position
+#define TT_DEPTH_SLACK 2
+
+enum Bound {
+  NoBound, UpperBound, LowerBound, ExactBound
+};
+
+/*
+ * Everything but the key is packed into one 64 bit word:
+ *   bits  0-15 move
+ *   bits 16-31 score, signed
+ *   bits 32-47 static evaluation, signed
+ *   bits 48-55 depth
+ *   bits 56-57 bound
+ *   bits 58-63 generation of the search that stored it
+ */
+#define TT_DATA(m, s, e, d, b, g) \
+  ((U64)(unsigned short)(m) | ((U64)(unsigned short)(s) << 16) | ((U64)(unsigned short)(e) << 32) | \
+   ((U64)(d) << 48) | ((U64)(b) << 56) | ((U64)(g) << 58))
+#define TT_MOVE(d) ((int)((d) & 0xFFFF))
+#define TT_SCORE(d) ((int)(short)(((d) >> 16) & 0xFFFF))
+#define TT_EVAL(d) ((int)(short)(((d) >> 32) & 0xFFFF))
+#define TT_DEPTH(d) ((int)(((d) >> 48) & 0xFF))
+#define TT_BOUND(d) ((int)(((d) >> 56) & 0x3))
+#define TT_GENERATION(d) ((int)(((d) >> 58) & 0x3F))
+
+/*
+ * Threads share the table without locks. The key is stored xored with the
+ * data, so an entry torn by two threads writing it at once no longer matches
+ * any position and is simply missed. Both words are relaxed atomics, plain
+ * moves on x86-64, so the sharing is not a data race.
+ */
+typedef struct {
+  std::atomic<U64> key;
+  std::atomic<U64> data;
+} TtEntry;
+
+// One cache line, the table is allocated 64 byte aligned
+typedef struct alignas(64) {
+  TtEntry entries[TT_ENTRIES_PER_BUCKET];
+} TtBucket;
+
+class TransTable {
+public:
+  static bool probe(const Board &board, U64 &data);
+  static int probe_move(const Board &board);
+  static void prefetch(const U64 key);
+  static void store(const Board &board, const int move, const int score, const int eval, const int depth,
+                    const int bound);
+  static int get_pv_line(const int depth, Board &board, unsigned short *pv_array);
+  static void new_search();
+  static void init(const int megabytes);
+  static void clear();
+  static void free_table();
+private:
+  static TtBucket *table;
+  static U64 num_buckets;
+  static int generation;
+};
@@ -12,10 +12,11 @@
 #endif
 
 #include "uci.h"
-#include "pvtable.h"
+#include "transtable.h"
 #include "movegen.h"
 #include "makemove.h"
 #include "time.h"
+#include "perft.h"
 
 /*
  * Code taken from 
@@ -29,9 +30,14 @@ void Uci::loop(Board &board, SearchInfo &info) {
   char line[INPUTBUFFER];
   printf("id name %s\n", NAME);
   printf("id author Bart\n");
+  printf("option name CopyMake type check default false\n");
+  printf("option name Threads type spin default 1 min 1 max %d\n", MAX_THREADS);
   printf("uciok\n");
+  printf("info string slider attacks %s\n", BitBoard::slider_backend_names[BitBoard::slider_backend]);
+  printf("info string attack fills %s\n", BitBoard::fill_avx2 ? "avx2" : "scalar");
+  printf("info string popcount %s\n", BitBoard::popcnt_hw ? "popcnt" : "software");
 
-  PvTable::init();
+  TransTable::init(TT_DEFAULT_MB);
 
   while (true) {
     memset(&line[0], 0, sizeof(line));
@@ -52,11 +58,27 @@ void Uci::loop(Board &board, SearchInfo &info) {
       parse_position(line, board);
     }
     else if (!strncmp(line, "ucinewgame", 10)) {
+      TransTable::clear();
       parse_position((char*) "position startpos\n", board);
     }
     else if (!strncmp(line, "go", 2)) {
       parse_go(line, info, board);
     }
+    else if (!strncmp(line, "setoption", 9)) {
+      parse_setoption(line);
+    }
+    else if (!strncmp(line, "bench threads", 13)) {
+      int depth = atoi(line + 13);
+      Searcher::bench_threads(depth > 0 ? depth : 12);
+    }
+    else if (!strncmp(line, "bench search", 12)) {
+      int depth = atoi(line + 12);
+      Searcher::bench(depth > 0 ? depth : 12);
+    }
+    else if (!strncmp(line, "bench", 5)) {
+      int depth = atoi(line + 5);
+      Perft::bench(depth > 0 ? depth : 5, board);
+    }
     else if (!strncmp(line, "quit", 4)) {
       info.quit = true;
       break;
@@ -64,12 +86,14 @@ void Uci::loop(Board &board, SearchInfo &info) {
     else if (!strncmp(line, "uci", 3)) {
       printf("id name %s\n", NAME);
       printf("id author Bart\n");
+      printf("option name CopyMake type check default false\n");
+      printf("option name Threads type spin default 1 min 1 max %d\n", MAX_THREADS);
       printf("uciok\n");
     }
     if (info.quit) break;
   } 
 
-  PvTable::free_table();
+  TransTable::free_table();
 }
 
 void Uci::parse_position(char *lineIn, Board &board) {
@@ -107,11 +131,25 @@ void Uci::parse_position(char *lineIn, Board &board) {
   board.print_board();
 }
 
+void Uci::parse_setoption(char *line) {
+  char *ptr = NULL;
+
+  if ((ptr = strstr(line, "name CopyMake value "))) {
+    MoveMaker::copy_make = !strncmp(ptr + 20, "true", 4);
+    printf("info string make mode %s\n", MoveMaker::copy_make ? "copy-make" : "make/take");
+  }
+  else if ((ptr = strstr(line, "name Threads value "))) {
+    Searcher::set_threads(atoi(ptr + 19));
+    printf("info string threads %d\n", Searcher::num_threads);
+  }
+}
+
 void Uci::parse_go(char *line, SearchInfo &info, Board &board) {
   int depth = -1, movestogo = 30, movetime = -1;
   int time = -1, inc = 0;
   char *ptr = NULL;
   info.time_set = false;
+  info.bench = false;
 
   if ((ptr = strstr(line, "infinite"))) {
     ;
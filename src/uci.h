@@ -11,6 +11,7 @@ public:
   static void loop(Board& board, SearchInfo &info);
   static void parse_go(char *line, SearchInfo &info, Board &board);
   static void parse_position(char *lineIn, Board &board);
+  static void parse_setoption(char *line);
   static void read_input(SearchInfo &info);
 private:
   static bool input_waiting();
@@ -1,28 +1,37 @@
-#include <cstdlib>
-
 #include "zobrist.h"
 
-#define RAND_64 (  (U64)rand() | \
-                   (U64)rand() << 15 | \
-                   (U64)rand() << 30 | \
-                   (U64)rand() << 45 | \
-                   ((U64)rand() & 0xF) << 60  )
-                  
+/*
+ * Keys come from splitmix64 over a fixed seed and are computed by the
+ * compiler, so every build and every run hashes a position the same way.
+ * Key n is the n-th output: the piece keys first, then side and castling.
+ */
+static constexpr U64 ZOBRIST_SEED = 0x4B43686573733031ULL;
 
-U64 Zobrist::piece_keys[13][64] = {0};
-U64 Zobrist::side_key = 0;
-U64 Zobrist::castle_keys[16] = {0};
+static constexpr U64 random_key(const int n) {
+  U64 z = ZOBRIST_SEED + (U64)(n + 1) * 0x9E3779B97F4A7C15ULL;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
 
-void Zobrist::init() {
+static constexpr std::array<std::array<U64, 64>, 13> make_piece_keys() {
+  std::array<std::array<U64, 64>, 13> keys{};
   for (int i = 0; i < 13; i++) {
     for (int j = 0; j < 64; j++) {
-      piece_keys[i][j] = RAND_64;
+      keys[i][j] = random_key(i * 64 + j);
     }
   }
+  return keys;
+}
 
-  side_key = RAND_64;
-
+static constexpr std::array<U64, 16> make_castle_keys() {
+  std::array<U64, 16> keys{};
   for (int i = 0; i < 16; i++) {
-    castle_keys[i] = RAND_64;
+    keys[i] = random_key(13 * 64 + 1 + i);
   }
+  return keys;
 }
+
+constexpr std::array<std::array<U64, 64>, 13> Zobrist::piece_keys = make_piece_keys();
+constexpr U64 Zobrist::side_key = random_key(13 * 64);
+constexpr std::array<U64, 16> Zobrist::castle_keys = make_castle_keys();
@@ -1,11 +1,12 @@
 #pragma once
 
+#include <array>
+
 typedef unsigned long long U64;
 
 class Zobrist {
 public:
-  static void init();
-  static U64 piece_keys[13][64];
-  static U64 side_key;
-  static U64 castle_keys[16];
+  static const std::array<std::array<U64, 64>, 13> piece_keys;
+  static const U64 side_key;
+  static const std::array<U64, 16> castle_keys;
 };